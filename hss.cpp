@@ -1,280 +1,861 @@
+// Command-line driver for the HSS library in hss.hpp: generates datasets, runs the sorter
+// and reports validation and per-phase timings
+#include "hss.hpp"
+
 #include <iostream>
 #include <vector>
 #include <algorithm>
 #include <random>
-#include <pthread.h>
-#include <cmath>
 #include <string>
-#include <set>
+#include <chrono>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <new>
 #include <numeric>
-#include <chrono> // Added for timing
+#include <sstream>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+#ifdef HSS_PAR_UNSEQ
+#include <execution>
+#endif
+
+using hss::Clock;
+using hss::Duration;
+using hss::KeyLess;
+using hss::KeyValue;
+using hss::StringRef;
+
+// Heap allocations made by the current thread; counted by the replacement operator new below
+// and handed to the sorter as its allocation probe
+thread_local uint64_t thread_allocations = 0;
+
+void* operator new(size_t size) {
+    thread_allocations++;
+    if (void* block = std::malloc(size ? size : 1)) return block;
+    throw std::bad_alloc();
+}
+
+// GCC flags free() on memory from operator new once these are inlined; they pair with malloc above
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete(void* block, size_t) noexcept { std::free(block); }
+#pragma GCC diagnostic pop
 
-// Using directives for cleaner timing code
-using Clock = std::chrono::high_resolution_clock;
-using Duration = std::chrono::duration<double>;
+uint64_t current_thread_allocations() { return thread_allocations; }
 
-// Global configuration structure for shared settings and synchronization
+// Command-line settings for one run of the driver
 struct Config {
     int num_workers;                    // Number of parallel workers (threads)
     int random_seed;                    // Seed for reproducible randomization
     size_t total_elements;              // Total number of elements to sort
     bool verbose_output;                // Enable detailed debug prints
-    std::vector<long long> dataset;     // Original unsorted dataset (using long long for large values)
-    std::vector<long long> splitters;   // Selected partition boundaries
-    pthread_barrier_t barrier;          // Synchronization barrier for threads
-    pthread_mutex_t lock;               // Mutex for shared data protection
-    double max_imbalance;               // Allowed load imbalance ratio (ε), not used yet
-    
-    // For data exchange between workers
-    std::vector<std::vector<long long>> bucket_contributions; // [bucket_id][elements]
-    std::vector<pthread_mutex_t> bucket_locks;               // One mutex per bucket
-};
-Config global_config;
-
-// Per-thread execution state
-struct WorkerContext {
-    int worker_id;                      // Unique worker ID (0 to num_workers-1)
-    std::vector<long long> local_chunk; // Subset of data assigned to this worker
-    std::vector<long long> local_samples; // Locally sampled pivot candidates
-    // Timing variables (in seconds) for each phase
-    double phase1_duration;             // Initial partitioning and local sorting
-    double phase2a_duration;            // Sample selection and contribution
-    double phase2b_duration;            // Splitter selection (leader only)
-    double phase3_duration;             // Partitioning and data exchange
-    double phase4_duration;             // Final bucket sorting
+    std::string key_type;               // Key type selected with --type= (i64, i32, u32, u64, f32, f64, string, record)
+    double max_imbalance;               // Allowed load imbalance ratio (ε), sets the oversampling
+    size_t oversampling;                // Samples per bucket (--oversampling=); 0 derives it from N, p and ε
+    int splitter_rounds;                // Splitter rounds refining a missed ε target (--rounds=)
+    std::vector<int> cpu_affinity;      // CPUs selected with --cpus= for pinning workers
+    bool stable;                        // Preserve the input order of equal keys (--stable)
+    std::string distribution;           // Generated key distribution (--dist=squares|uniform|zipf)
+    int repeat;                         // Sorts of the same input with one sorter (--repeat=)
+    hss::HugePages huge_pages;          // Page backing of large buffers (--huge-pages=)
+    bool populate;                      // Pre-fault large buffers (--populate)
+    bool in_place;                      // Block-permuting in-place exchange (--in-place)
+    bool processes;                     // Forked worker processes on shared memory (--processes)
+    std::string distributed;            // Distributed ranks (--distributed=local|mpi) or empty
+    int levels;                         // Splitting levels of the distributed sort (--levels=)
+    bool compress;                      // Delta-encoded, bit-packed distributed exchange (--compress)
+    bool partial;                       // Order only output ranks [range_begin, range_end) (--range=, --topk=)
+    size_t range_begin;
+    size_t range_end;
+    std::string report;                 // Structured report instead of prose: "json", "csv" or empty
+    std::string trace_file;             // Chrome trace of the sorts written on exit (--trace=, needs HSS_TRACE)
+
+    // Benchmark sweep mode (--bench)
+    bool bench;
+    int bench_reps;                     // Measured sorts per configuration (--reps=)
+    int bench_warmup;                   // Discarded warm-up sorts per configuration (--warmup=)
+    std::vector<int> sweep_workers;     // Worker counts (--sweep-workers=), ascending
+    std::vector<size_t> sweep_sizes;    // Strong-scaling sizes (--sweep-sizes=), ascending
+    std::vector<std::string> sweep_types; // Key types (--sweep-types=)
+    std::vector<std::string> sweep_dists; // Distributions (--sweep-dists=)
+    bool baselines;                     // Time the baseline sorters too (off with --no-baselines)
+
+    // Streaming ingest mode
+    bool streaming;                     // Read keys from stdin in batches of total_elements
 };
 
-// Print debug messages if verbose mode is enabled or forced
-void debug_print(const std::string& message, bool force = false) {
-    if (global_config.verbose_output || force) {
+// Print debug messages if verbose mode is enabled
+void debug_print(const Config& config, const std::string& message) {
+    if (config.verbose_output) {
         std::cerr << "[DEBUG] " << message << "\n";
     }
 }
 
-// Print vector contents (limited to first 10 elements for brevity)
-void print_vector(const std::string& label, const std::vector<long long>& vec, bool force_verbose = false) {
-    if (!global_config.verbose_output && !force_verbose) return;
-    std::cerr << "[DEBUG] " << label << " (" << vec.size() << " elements): [";
-    for (size_t i = 0; i < std::min(vec.size(), 10UL); ++i) {
-        std::cerr << vec[i] << (i < vec.size()-1 ? ", " : "");
-    }
-    if (vec.size() > 10) std::cerr << "...";
-    std::cerr << "]\n";
-}
-
-// Worker thread function implementing the HSS algorithm with timing
-void* worker_function(void* arg) {
-    WorkerContext* ctx = static_cast<WorkerContext*>(arg);
-    const int worker_id = ctx->worker_id;
-    const size_t dataset_size = global_config.total_elements;
-    const int total_workers = global_config.num_workers;
-
-    // Phase 1: Initial Data Partitioning and Local Sorting
-    auto start_phase1 = Clock::now();
-    const size_t base_chunk_size = dataset_size / total_workers;
-    const size_t chunk_start = worker_id * base_chunk_size;
-    const size_t chunk_end = (worker_id == total_workers - 1) 
-                           ? dataset_size 
-                           : chunk_start + base_chunk_size;
-    
-    ctx->local_chunk.assign(global_config.dataset.begin() + chunk_start,
-                           global_config.dataset.begin() + chunk_end);
-    std::sort(ctx->local_chunk.begin(), ctx->local_chunk.end());
-    auto end_phase1 = Clock::now();
-    ctx->phase1_duration = Duration(end_phase1 - start_phase1).count();
-
-    debug_print("Worker " + std::to_string(worker_id) + 
-                " initial chunk size: " + std::to_string(ctx->local_chunk.size()));
-    print_vector("Worker " + std::to_string(worker_id) + " initial chunk", ctx->local_chunk);
-
-    pthread_barrier_wait(&global_config.barrier); // Barrier after Phase 1
-
-    // Phase 2a: Sample Selection and Contribution
-    auto start_phase2a = Clock::now();
-    const int samples_per_worker = 10 * total_workers; // Oversampling for better splitters
-    ctx->local_samples.clear();
-    if (ctx->local_chunk.size() >= (size_t)samples_per_worker) {
-        // Use a worker-specific seed for reproducibility
-        std::mt19937 rng(global_config.random_seed + worker_id);
-        std::sample(ctx->local_chunk.begin(), ctx->local_chunk.end(),
-                    std::back_inserter(ctx->local_samples), samples_per_worker, rng);
+// Library options for the configured run
+hss::Options make_options(const Config& config) {
+    hss::Options options;
+    options.num_workers = config.num_workers;
+    options.random_seed = config.random_seed;
+    options.max_imbalance = config.max_imbalance;
+    options.oversampling = config.oversampling;
+    options.max_splitter_rounds = config.splitter_rounds;
+    options.levels = config.levels;
+    options.compress_exchange = config.compress;
+    options.verbose_output = config.verbose_output;
+    options.cpu_affinity = config.cpu_affinity;
+    options.stable = config.stable;
+    options.allocation_counter = current_thread_allocations;
+    options.huge_pages = config.huge_pages;
+    options.populate = config.populate;
+    options.count_hardware_events = true;
+    options.in_place = config.in_place;
+    options.trace = !config.trace_file.empty();
+    return options;
+}
+
+// Position in the key stream on stdin, and the first token that was not a key
+struct InputPosition {
+    size_t line = 1;                    // Line of the next key
+    bool failed = false;
+    std::string bad_token;
+};
+
+// Read up to batch_size keys from stdin; returns false once input is exhausted or a token is
+// not a key (position.failed). Whitespace is skipped by hand to count lines, because a failed
+// extraction looks like the end of input to the stream
+template <typename Key>
+bool read_batch(std::vector<Key>& batch, size_t batch_size, InputPosition& position) {
+    batch.clear();
+    Key value;
+    while (batch.size() < batch_size) {
+        int c;
+        while ((c = std::cin.peek()) != EOF && std::isspace(c)) {
+            if (c == '\n') position.line++;
+            std::cin.get();
+        }
+        if (c == EOF) break;
+        if (!(std::cin >> value)) {
+            std::cin.clear();
+            std::cin >> position.bad_token;
+            position.failed = true;
+            return false;
+        }
+        batch.push_back(value);
+    }
+    return !batch.empty();
+}
+
+// Streaming mode: ingest batches from stdin, sort each with HSS while the next one
+// is being read, merge runs in the background, and write the sorted keys on flush
+template <typename Key>
+int run_streaming(const Config& config) {
+    std::ios::sync_with_stdio(false);
+    const size_t batch_size = std::max<size_t>(config.total_elements, 1);
+
+    auto total_start = Clock::now();
+    hss::StreamSorter<Key> stream(make_options(config));
+
+    // Double buffering: the next batch is read while the previous one is sorted
+    std::vector<Key> pending;
+    double ingest_time = 0.0;
+    InputPosition position;
+    while (true) {
+        auto start_read = Clock::now();
+        bool has_batch = read_batch(pending, batch_size, position);
+        ingest_time += Duration(Clock::now() - start_read).count();
+        if (position.failed) {
+            std::cerr << "Invalid " << config.key_type << " key on line " << position.line << " of the input: \""
+                      << position.bad_token << "\"\n";
+            return 1;
+        }
+        if (!has_batch) break;
+
+        debug_print(config, "Ingested batch " + std::to_string(stream.batches() + 1) + " with " +
+                            std::to_string(pending.size()) + " keys");
+        stream.add_batch(std::move(pending));
+        pending = std::vector<Key>();
+    }
+
+    // Flush: let the merger drain full levels, then merge whatever runs remain
+    std::vector<Key> sorted_output = stream.flush();
+    double total_time = Duration(Clock::now() - total_start).count();
+
+    if constexpr (std::is_floating_point_v<Key>) {
+        std::cout << std::setprecision(std::numeric_limits<Key>::max_digits10);
+    }
+    for (const Key& value : sorted_output) {
+        std::cout << value << '\n';
+    }
+    std::cout.flush();
+
+    // Statistics go to stderr so stdout carries only the sorted keys
+    const bool is_valid = sorted_output.size() == stream.keys_ingested() &&
+                          std::is_sorted(sorted_output.begin(), sorted_output.end(), stream.less());
+    std::cerr << "Validation: " << (is_valid ? "Sorted correctly!" : "Sorting failed!") << "\n";
+    std::cerr << "\nStreaming Summary:\n";
+    std::cerr << "Keys Ingested: " << stream.keys_ingested() << " in " << stream.batches()
+              << " batches of up to " << batch_size << "\n";
+    std::cerr << "Background Merges: " << stream.background_merges()
+              << " (" << stream.merge_duration() << " seconds)\n";
+    std::cerr << "Runs Merged at Flush: " << stream.final_runs()
+              << " (" << stream.flush_duration() << " seconds)\n";
+    std::cerr << "Ingest Time: " << ingest_time << " seconds\n";
+    std::cerr << "Batch Sorting Time (HSS): " << stream.sort_duration() << " seconds\n";
+    std::cerr << "Measured Total Time: " << total_time << " seconds\n";
+    return is_valid ? 0 : 1;
+}
+
+const char* huge_pages_name(hss::HugePages huge_pages) {
+    switch (huge_pages) {
+        case hss::HugePages::Transparent: return "thp";
+        case hss::HugePages::Explicit: return "hugetlb";
+        default: return "off";
+    }
+}
+
+// Anonymous memory currently backed by transparent huge pages (Linux), or 0 if unknown
+size_t anon_huge_pages_kb() {
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(rollup, line)) {
+        if (line.rfind("AnonHugePages:", 0) == 0) {
+            return std::stoul(line.substr(14));
+        }
+    }
+    return 0;
+}
+
+// Field of /proc/self/status in kB (VmRSS: resident set, VmHWM: its peak); 0 if unavailable
+size_t status_kb(const std::string& field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind(field + ":", 0) == 0) {
+            return std::stoul(line.substr(field.size() + 1));
+        }
+    }
+    return 0;
+}
+
+// Restart the peak resident set size (VmHWM) from the current one (Linux 4.0+)
+bool reset_peak_rss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    return static_cast<bool>(clear_refs << "5" << std::flush);
+}
+
+// Host CPU model from /proc/cpuinfo, or "unknown"
+std::string cpu_model() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            const size_t colon = line.find(':');
+            if (colon != std::string::npos && colon + 2 <= line.size()) return line.substr(colon + 2);
+        }
+    }
+    return "unknown";
+}
+
+// String as a JSON (or quoted CSV) literal
+std::string quoted(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+// Key for element i of the generated dataset (i >= 1)
+template <typename Key>
+Key make_key(uint64_t i) {
+    if constexpr (std::is_floating_point_v<Key>) {
+        // Squares with alternating sign exercise the negative half of the float order
+        const Key square = static_cast<Key>(i) * static_cast<Key>(i);
+        return (i % 2 == 0) ? square : -square;
+    } else if constexpr (sizeof(Key) < sizeof(uint64_t)) {
+        // Squares overflow narrow keys; multiplying by an odd constant is a bijection mod 2^32
+        return static_cast<Key>(static_cast<uint32_t>(i * 2654435761ULL));
+    } else {
+        return static_cast<Key>(i * i);
+    }
+}
+
+// Skew of the Zipf distribution: the most frequent key is about 18% of the input
+constexpr double ZIPF_EXPONENT = 1.2;
+constexpr uint64_t ZIPF_MAX_RANK = 1 << 20; // Distinct keys available to the Zipf distribution
+
+// Call fn(i, index) for every element with the 1-based index passed to make_key. squares
+// visits 1..N once each (shuffled afterwards); uniform draws from 1..N with repetition;
+// zipf draws rank r with probability proportional to 1 / r^ZIPF_EXPONENT
+template <typename Fn>
+void for_each_index(const Config& config, Fn fn) {
+    const size_t n = config.total_elements;
+    std::mt19937_64 rng(config.random_seed);
+    if (config.distribution == "uniform") {
+        std::uniform_int_distribution<uint64_t> uniform(1, std::max<uint64_t>(n, 1));
+        for (size_t i = 0; i < n; ++i) fn(i, uniform(rng));
+    } else if (config.distribution == "zipf") {
+        // Inverse transform sampling over the cumulative weights of the ranks
+        const uint64_t ranks = std::min<uint64_t>(std::max<uint64_t>(n, 1), ZIPF_MAX_RANK);
+        std::vector<double> cumulative(ranks);
+        double total = 0.0;
+        for (uint64_t r = 0; r < ranks; ++r) {
+            total += 1.0 / std::pow(static_cast<double>(r + 1), ZIPF_EXPONENT);
+            cumulative[r] = total;
+        }
+        std::uniform_real_distribution<double> uniform(0.0, total);
+        for (size_t i = 0; i < n; ++i) {
+            const auto rank = std::lower_bound(cumulative.begin(), cumulative.end(), uniform(rng));
+            fn(i, std::min<uint64_t>(rank - cumulative.begin(), ranks - 1) + 1);
+        }
     } else {
-        ctx->local_samples = ctx->local_chunk;
-    }
-
-    // Contribute samples to global splitters (thread-safe)
-    pthread_mutex_lock(&global_config.lock);
-    global_config.splitters.insert(global_config.splitters.end(),
-                                   ctx->local_samples.begin(), ctx->local_samples.end());
-    pthread_mutex_unlock(&global_config.lock);
-    auto end_phase2a = Clock::now();
-    ctx->phase2a_duration = Duration(end_phase2a - start_phase2a).count();
-    
-    pthread_barrier_wait(&global_config.barrier); // Barrier after sample contribution
-
-    // Phase 2b: Splitter Selection by Leader
-    auto start_phase2b = Clock::now();
-    if (worker_id == 0) {
-        std::sort(global_config.splitters.begin(), global_config.splitters.end());
-        const size_t total_samples = global_config.splitters.size();
-        const size_t splitter_step = total_samples / total_workers;
-        
-        global_config.splitters.clear();
-        for (int i = 1; i < total_workers; ++i) {
-            size_t idx = i * splitter_step;
-            if (idx < total_samples) {
-                global_config.splitters.push_back(global_config.splitters[idx]);
+        for (size_t i = 0; i < n; ++i) fn(i, i + 1); // From 1 to N
+    }
+}
+
+// Generated input together with the comparator that orders it
+template <typename Key>
+struct Dataset {
+    hss::Buffer<Key> keys;              // Backed like the sorter's buffers (--huge-pages, --populate)
+    std::vector<char> arena;            // Bytes of string keys (unused for other types)
+
+    KeyLess<Key> less() const { return KeyLess<Key>(); }
+};
+
+template <>
+KeyLess<StringRef> Dataset<StringRef>::less() const {
+    KeyLess<StringRef> less;
+    less.arena = arena.data();
+    return less;
+}
+
+// Generate the configured distribution; the default squares are skewed but free of
+// duplicates and are shuffled with the configured seed
+template <typename Key>
+void generate_dataset(const Config& config, Dataset<Key>& dataset) {
+    dataset.keys.resize(config.total_elements);
+    for_each_index(config, [&](size_t i, uint64_t index) {
+        dataset.keys[i] = make_key<Key>(index);
+    });
+    if (config.distribution == "squares") {
+        std::mt19937 rng(config.random_seed);
+        std::shuffle(dataset.keys.begin(), dataset.keys.end(), rng);
+    }
+}
+
+// String keys "user/<i squared>" share a 5-byte prefix, so many cached prefixes tie and
+// fall back to the arena; only the 16-byte references are shuffled and exchanged
+template <>
+void generate_dataset<StringRef>(const Config& config, Dataset<StringRef>& dataset) {
+    std::vector<char>& arena = dataset.arena;
+    arena.clear();
+    dataset.keys.resize(config.total_elements);
+    for_each_index(config, [&](size_t i, uint64_t index) {
+        const std::string key = "user/" + std::to_string(index * index);
+        dataset.keys[i].offset = static_cast<uint32_t>(arena.size());
+        dataset.keys[i].length = static_cast<uint32_t>(key.size());
+        arena.insert(arena.end(), key.begin(), key.end());
+    });
+    if (arena.size() > std::numeric_limits<uint32_t>::max()) {
+        std::cerr << "String arena exceeds 4 GiB; reduce <size> for --type=string\n";
+        std::exit(1);
+    }
+    for (StringRef& key : dataset.keys) {
+        key.prefix = hss::string_prefix(arena.data() + key.offset, key.length);
+    }
+    if (config.distribution == "squares") {
+        std::mt19937 rng(config.random_seed);
+        std::shuffle(dataset.keys.begin(), dataset.keys.end(), rng);
+    }
+}
+
+// Events of the last sort that every worker could count
+template <typename Key>
+std::array<bool, hss::EventCount> counted_events(const std::vector<hss::WorkerContext<Key>>& contexts) {
+    std::array<bool, hss::EventCount> counted;
+    for (int event = 0; event < hss::EventCount; ++event) {
+        counted[event] = std::all_of(contexts.begin(), contexts.end(), [event](const hss::WorkerContext<Key>& ctx) {
+            return ctx.perf_counters.valid(event);
+        });
+    }
+    return counted;
+}
+
+// Hardware counters of the last sort per phase, summed over workers and then for every worker:
+// IPC and misses per thousand instructions (MPKI). Events the kernel refused show n/a, and
+// without perf_event access only the timings remain
+template <typename Key>
+void print_hardware_counters(const std::vector<hss::WorkerContext<Key>>& contexts) {
+    const std::array<bool, hss::EventCount> counted = counted_events(contexts);
+    if (std::none_of(counted.begin(), counted.end(), [](bool ok) { return ok; })) {
+        std::cout << "\nHardware Counters: n/a, timing only (perf_event not permitted, see "
+                     "/proc/sys/kernel/perf_event_paranoid)\n";
+        return;
+    }
+    auto print_row = [&](const std::string& label, const std::array<uint64_t, hss::EventCount>& events) {
+        const double instructions = static_cast<double>(events[hss::Instructions]);
+        std::cout << label << ":";
+        for (int event : {hss::Cycles, hss::Instructions}) {
+            std::cout << " " << (counted[event] ? std::to_string(events[event]) : "n/a") << " "
+                      << hss::event_name(event) << ",";
+        }
+        std::cout << " IPC ";
+        if (counted[hss::Cycles] && counted[hss::Instructions] && events[hss::Cycles] > 0) {
+            std::cout << instructions / events[hss::Cycles];
+        } else {
+            std::cout << "n/a";
+        }
+        for (int event : {hss::LlcMisses, hss::BranchMisses, hss::DtlbMisses}) {
+            std::cout << ", " << hss::event_name(event) << " ";
+            if (counted[event] && counted[hss::Instructions] && instructions > 0) {
+                std::cout << events[event] * 1000.0 / instructions << " MPKI";
+            } else {
+                std::cout << "n/a";
             }
         }
-        while (global_config.splitters.size() < (size_t)total_workers - 1) {
-            global_config.splitters.push_back(global_config.splitters.back());
+        std::cout << "\n";
+    };
+    std::cout << "\nHardware Counters per Phase (last sort, all workers):\n";
+    for (int phase = 0; phase < hss::PhaseCount; ++phase) {
+        std::array<uint64_t, hss::EventCount> total{};
+        for (const auto& ctx : contexts) {
+            for (int event = 0; event < hss::EventCount; ++event) total[event] += ctx.phase_events[phase][event];
         }
-        print_vector("Selected splitters", global_config.splitters, true);
+        print_row(hss::phase_name(phase), total);
     }
-    auto end_phase2b = Clock::now();
-    ctx->phase2b_duration = (worker_id == 0) ? Duration(end_phase2b - start_phase2b).count() : 0.0;
+    std::cout << "Per worker:\n";
+    for (const auto& ctx : contexts) {
+        for (int phase = 0; phase < hss::PhaseCount; ++phase) {
+            print_row("Worker " + std::to_string(ctx.worker_id) + " " + hss::phase_name(phase), ctx.phase_events[phase]);
+        }
+    }
+}
 
-    pthread_barrier_wait(&global_config.barrier); // Barrier after splitter selection
+// Pearson correlation of two equally long series; 0 if either is constant
+double correlation(const std::vector<double>& x, const std::vector<double>& y) {
+    const double n = static_cast<double>(x.size());
+    if (n < 2) return 0.0;
+    const double mean_x = std::accumulate(x.begin(), x.end(), 0.0) / n;
+    const double mean_y = std::accumulate(y.begin(), y.end(), 0.0) / n;
+    double covariance = 0.0, variance_x = 0.0, variance_y = 0.0;
+    for (size_t i = 0; i < x.size(); ++i) {
+        covariance += (x[i] - mean_x) * (y[i] - mean_y);
+        variance_x += (x[i] - mean_x) * (x[i] - mean_x);
+        variance_y += (y[i] - mean_y) * (y[i] - mean_y);
+    }
+    return variance_x > 0 && variance_y > 0 ? covariance / std::sqrt(variance_x * variance_y) : 0.0;
+}
 
-    // Phase 3: Partition and Exchange Data
-    auto start_phase3 = Clock::now();
-    std::vector<std::vector<long long>> local_buckets(total_workers);
-    for (long long value : ctx->local_chunk) {
-        auto split_pos = std::upper_bound(global_config.splitters.begin(),
-                                          global_config.splitters.end(), value);
-        int bucket_idx = std::distance(global_config.splitters.begin(), split_pos);
-        bucket_idx = std::clamp(bucket_idx, 0, total_workers - 1);
-        local_buckets[bucket_idx].push_back(value);
+// Bucket balance and splitter quality of the last sort
+struct BalanceSummary {
+    double average_bucket;              // N / p
+    size_t largest_bucket;
+    double target_bucket;               // (1 + ε) * N / p
+    std::vector<long long> rank_errors; // Splitter rank minus its ideal rank (i + 1) * N / p
+    double max_rank_error;              // Largest |rank error| relative to N / p
+    double phase4_correlation;          // Between bucket size and Phase 4 time over workers
+};
+
+template <typename Key>
+BalanceSummary balance_summary(const Config& config, const hss::Sorter<Key>& sorter) {
+    const auto& contexts = sorter.workers();
+    const size_t n = config.total_elements;
+    const int p = static_cast<int>(contexts.size());
+    BalanceSummary balance;
+    balance.average_bucket = static_cast<double>(n) / p;
+    balance.largest_bucket = 0;
+    balance.target_bucket = balance.average_bucket * (1.0 + config.max_imbalance);
+    balance.max_rank_error = 0.0;
+    const std::vector<size_t> ranks = sorter.splitter_ranks();
+    for (size_t i = 0; i < ranks.size(); ++i) {
+        const long long ideal = static_cast<long long>((i + 1) * n / p);
+        balance.rank_errors.push_back(static_cast<long long>(ranks[i]) - ideal);
+        if (balance.average_bucket > 0) {
+            balance.max_rank_error = std::max(balance.max_rank_error,
+                                              std::abs(balance.rank_errors.back()) / balance.average_bucket);
+        }
+    }
+    std::vector<double> sizes, phase4;
+    for (const auto& ctx : contexts) {
+        balance.largest_bucket = std::max(balance.largest_bucket, ctx.bucket_size);
+        sizes.push_back(static_cast<double>(ctx.bucket_size));
+        phase4.push_back(ctx.phase4_duration);
+    }
+    balance.phase4_correlation = correlation(sizes, phase4);
+    return balance;
+}
+
+// Every bucket's size and Phase 4 time against the ε target, and the rank error of the
+// splitter above it, to show when more samples or a refinement round would pay off
+template <typename Key>
+void print_balance(const Config& config, const hss::Sorter<Key>& sorter) {
+    const auto& contexts = sorter.workers();
+    const BalanceSummary balance = balance_summary(config, sorter);
+    const double largest_ratio = balance.average_bucket > 0 ? balance.largest_bucket / balance.average_bucket : 0.0;
+    double largest_phase4 = 0.0;
+    for (const auto& ctx : contexts) {
+        if (ctx.bucket_size == balance.largest_bucket) largest_phase4 = std::max(largest_phase4, ctx.phase4_duration);
     }
 
-    // Contribute to global buckets (thread-safe)
-    for (int i = 0; i < total_workers; ++i) {
-        if (!local_buckets[i].empty()) {
-            pthread_mutex_lock(&global_config.bucket_locks[i]);
-            global_config.bucket_contributions[i].insert(
-                global_config.bucket_contributions[i].end(),
-                local_buckets[i].begin(), local_buckets[i].end());
-            pthread_mutex_unlock(&global_config.bucket_locks[i]);
+    std::cout << "\nLoad Balance and Splitter Quality:\n";
+    std::cout << "Samples: " << sorter.sample_size() << " (" << sorter.oversampling() << " per bucket"
+              << (config.oversampling > 0 ? ", --oversampling" : ", derived from N, p and ε") << ") for "
+              << contexts.size() - 1 << " splitters in round " << sorter.splitter_rounds() << " of at most "
+              << config.splitter_rounds << "\n";
+    std::cout << "Target: largest bucket <= (1 + " << config.max_imbalance << ") x average = "
+              << balance.target_bucket << " elements\n";
+    std::cout << "Imbalance: " << balance.largest_bucket << " elements = " << largest_ratio << "x average ("
+              << (balance.largest_bucket <= balance.target_bucket ? "within" : "exceeds") << " the target)\n";
+    std::cout << "Splitter Rank Error: at most " << 100.0 * balance.max_rank_error
+              << "% of the average bucket\n";
+    std::cout << "Phase 4 Time vs Bucket Size: correlation " << balance.phase4_correlation << "\n";
+    if (balance.largest_bucket > balance.target_bucket) {
+        // Phase 4 is roughly linear in the bucket size, so the largest bucket at the target
+        // would take proportionally less
+        const double balanced_phase4 = largest_phase4 * balance.target_bucket / balance.largest_bucket;
+        std::cout << "Refinement to the target would cut Phase 4 of the largest bucket from " << largest_phase4
+                  << " to about " << balanced_phase4 << " seconds\n";
+    }
+    std::cout << "Per bucket (size, x average, Phase 4 time, ns per element; rank error of the splitter above):\n";
+    for (const auto& ctx : contexts) {
+        std::cout << "Bucket " << ctx.worker_id << ": " << ctx.bucket_size << ", "
+                  << (balance.average_bucket > 0 ? ctx.bucket_size / balance.average_bucket : 0.0) << "x, "
+                  << ctx.phase4_duration << " seconds, "
+                  << (ctx.bucket_size > 0 ? ctx.phase4_duration * 1e9 / ctx.bucket_size : 0.0) << " ns"
+                  << (ctx.equality_bucket ? " (equality bucket, not sorted)" : "");
+        if (ctx.worker_id < (int)balance.rank_errors.size()) {
+            const long long error = balance.rank_errors[ctx.worker_id];
+            std::cout << "; splitter " << ctx.worker_id + 1 << " " << (error >= 0 ? "+" : "") << error << " ("
+                      << (balance.average_bucket > 0 ? 100.0 * error / balance.average_bucket : 0.0) << "%)";
         }
+        std::cout << "\n";
     }
-    auto end_phase3 = Clock::now();
-    ctx->phase3_duration = Duration(end_phase3 - start_phase3).count();
+}
 
-    pthread_barrier_wait(&global_config.barrier); // Barrier after data exchange
+// Barrier and lock counters of one worker summed over phases
+template <typename Key>
+hss::SyncCounters total_sync(const hss::WorkerContext<Key>& ctx) {
+    hss::SyncCounters total;
+    for (const hss::SyncCounters& sync : ctx.phase_sync) {
+        total.barrier_waits += sync.barrier_waits;
+        total.barrier_wait_ns += sync.barrier_wait_ns;
+        total.lock_acquisitions += sync.lock_acquisitions;
+        total.contended_acquisitions += sync.contended_acquisitions;
+        total.lock_wait_ns += sync.lock_wait_ns;
+    }
+    return total;
+}
 
-    // Phase 4: Final Sorting of Assigned Bucket
-    auto start_phase4 = Clock::now();
-    ctx->local_chunk = global_config.bucket_contributions[worker_id];
-    std::sort(ctx->local_chunk.begin(), ctx->local_chunk.end());
-    auto end_phase4 = Clock::now();
-    ctx->phase4_duration = Duration(end_phase4 - start_phase4).count();
+// Time the last sort spent in barriers and locks per phase, summed over workers, and per worker
+// as a share of the sort, so synchronization can be weighed against useful work
+template <typename Key>
+void print_synchronization(const std::vector<hss::WorkerContext<Key>>& contexts, double sort_seconds) {
+    std::cout << "\nSynchronization per Phase (barrier wait / lock acquisitions, contended / lock wait, all workers):\n";
+    for (int phase = 0; phase < hss::PhaseCount; ++phase) {
+        hss::SyncCounters total;
+        for (const auto& ctx : contexts) {
+            const hss::SyncCounters& sync = ctx.phase_sync[phase];
+            total.barrier_wait_ns += sync.barrier_wait_ns;
+            total.lock_acquisitions += sync.lock_acquisitions;
+            total.contended_acquisitions += sync.contended_acquisitions;
+            total.lock_wait_ns += sync.lock_wait_ns;
+        }
+        std::cout << hss::phase_name(phase) << ": " << total.barrier_wait_ns / 1e9 << " seconds / "
+                  << total.lock_acquisitions << ", " << total.contended_acquisitions << " / "
+                  << total.lock_wait_ns / 1e9 << " seconds\n";
+    }
+    std::cout << "Per worker:\n";
+    for (const auto& ctx : contexts) {
+        const hss::SyncCounters sync = total_sync(ctx);
+        const double waited = (sync.barrier_wait_ns + sync.lock_wait_ns) / 1e9;
+        std::cout << "Worker " << ctx.worker_id << ": " << sync.barrier_wait_ns / 1e9 << " seconds in "
+                  << sync.barrier_waits << " barrier waits, " << sync.lock_wait_ns / 1e9 << " seconds on "
+                  << sync.contended_acquisitions << " of " << sync.lock_acquisitions << " lock acquisitions ("
+                  << (sort_seconds > 0 ? 100.0 * waited / sort_seconds : 0.0) << "% of the sort)\n";
+    }
+}
 
-    debug_print("Worker " + std::to_string(worker_id) + 
-                " final chunk size: " + std::to_string(ctx->local_chunk.size()));
-    print_vector("Worker " + std::to_string(worker_id) + " final chunk", ctx->local_chunk);
+// Run-level results handed to the structured report
+struct RunSummary {
+    bool valid;
+    double sort_seconds;                // Reported sort (the last one with --repeat)
+    double validation_seconds;
+    size_t peak_rss_kb;                 // Peak resident set while sorting (0 if unknown)
+};
 
-    return nullptr;
+// JSON key of a phase: "Phase 2a" becomes "phase2a"
+std::string phase_key(int phase) {
+    std::string key = hss::phase_name(phase);
+    key.erase(std::remove(key.begin(), key.end(), ' '), key.end());
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+    return key;
 }
 
-// Main execution flow with total timing and initialization timers
-int main(int argc, char* argv[]) {
-    if (argc < 5) {
-        std::cerr << "Usage: " << argv[0] 
-                  << " <seed> <workers> <imbalance> <size> [--verbose]\n";
-        return 1;
+// --report=json|csv: configuration, host, run results and every worker's phase durations,
+// bucket and traffic. CSV has one row per worker and repeats the run columns on each row
+template <typename Key>
+void print_structured_report(const Config& config, const hss::Sorter<Key>& sorter, const RunSummary& run) {
+    const auto& contexts = sorter.workers();
+    const size_t n = config.total_elements;
+    size_t largest_bucket = 0;
+    size_t total_bytes_moved = 0;
+    std::vector<size_t> bytes_moved;
+    for (const auto& ctx : contexts) {
+        largest_bucket = std::max(largest_bucket, ctx.bucket_size);
+        // Elements of this worker's chunk that belong to another worker's bucket
+        const size_t kept = ctx.bucket_bounds[ctx.worker_id + 1] - ctx.bucket_bounds[ctx.worker_id];
+        bytes_moved.push_back((ctx.chunk_size - kept) * sizeof(Key));
+        total_bytes_moved += bytes_moved.back();
     }
+    const double average_bucket = contexts.empty() ? 0.0 : static_cast<double>(n) / contexts.size();
+    const double imbalance = average_bucket > 0 ? largest_bucket / average_bucket : 0.0;
+    const double keys_per_second = run.sort_seconds > 0 ? n / run.sort_seconds : 0.0;
+    const double gb_per_second = keys_per_second * sizeof(Key) / 1e9;
+    const std::string mode = config.stable ? "stable" : config.in_place ? "in-place" : "default";
+    const long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const std::array<bool, hss::EventCount> counted = counted_events(contexts);
+    const BalanceSummary balance = balance_summary(config, sorter);
 
-    // Parse command-line arguments
-    global_config.random_seed = std::stoi(argv[1]);
-    global_config.num_workers = std::stoi(argv[2]);
-    global_config.max_imbalance = std::stod(argv[3]);
-    global_config.total_elements = std::stoul(argv[4]);
-    global_config.verbose_output = (argc >= 6 && std::string(argv[5]) == "--verbose");
+    std::cout << std::setprecision(9);
+    if (config.report == "csv") {
+        std::cout << "seed,workers,elements,epsilon,key_type,key_bytes,backend,distribution,mode,cpu_model,cpus,"
+                     "valid,sort_seconds,validation_seconds,keys_per_second,gb_per_second,imbalance,"
+                     "splitter_rounds,sample_size,max_rank_error,phase4_bucket_correlation,peak_rss_kb,worker,phase1_seconds,phase2a_seconds,phase2b_seconds,"
+                     "phase3_seconds,phase4_seconds,chunk_size,bucket_size,equality_bucket,bytes_moved,barrier_waits,"
+                     "barrier_wait_seconds,lock_acquisitions,contended_lock_acquisitions,lock_wait_seconds\n";
+        for (const auto& ctx : contexts) {
+            const hss::SyncCounters sync = total_sync(ctx);
+            std::cout << config.random_seed << "," << contexts.size() << "," << n << "," << config.max_imbalance << ","
+                      << config.key_type << "," << sizeof(Key) << "," << quoted(hss::backend_name<Key>(config.in_place, config.stable)) << ","
+                      << config.distribution << "," << mode << "," << quoted(cpu_model()) << "," << online_cpus << ","
+                      << run.valid << "," << run.sort_seconds << "," << run.validation_seconds << ","
+                      << keys_per_second << "," << gb_per_second << "," << imbalance << ","
+                      << sorter.splitter_rounds() << "," << sorter.sample_size() << "," << balance.max_rank_error << ","
+                      << balance.phase4_correlation << "," << run.peak_rss_kb << "," << ctx.worker_id << ","
+                      << ctx.phase1_duration << "," << ctx.phase2a_duration << "," << ctx.phase2b_duration << ","
+                      << ctx.phase3_duration << "," << ctx.phase4_duration << "," << ctx.chunk_size << ","
+                      << ctx.bucket_size << "," << ctx.equality_bucket << "," << bytes_moved[ctx.worker_id] << ","
+                      << sync.barrier_waits << "," << sync.barrier_wait_ns / 1e9 << "," << sync.lock_acquisitions << ","
+                      << sync.contended_acquisitions << "," << sync.lock_wait_ns / 1e9 << "\n";
+        }
+        return;
+    }
 
-    // Time dataset generation
-    auto start_dataset_gen = Clock::now();
-    // Generate skewed dataset without duplicates
-    std::vector<long long> unique_sequence(global_config.total_elements);
-    for (size_t i = 0; i < global_config.total_elements; ++i) {
-        unique_sequence[i] = i + 1; // 1 to N
+    std::cout << "{\n";
+    std::cout << "  \"config\": {\"seed\": " << config.random_seed << ", \"workers\": " << contexts.size()
+              << ", \"elements\": " << n << ", \"epsilon\": " << config.max_imbalance
+              << ", \"key_type\": " << quoted(config.key_type) << ", \"key_bytes\": " << sizeof(Key)
+              << ", \"backend\": " << quoted(hss::backend_name<Key>(config.in_place, config.stable))
+              << ", \"distribution\": " << quoted(config.distribution) << ", \"mode\": " << quoted(mode)
+              << ", \"max_splitter_rounds\": " << config.splitter_rounds
+              << ", \"repeat\": " << config.repeat << ", \"huge_pages\": " << quoted(huge_pages_name(config.huge_pages))
+              << "},\n";
+    std::cout << "  \"host\": {\"cpu_model\": " << quoted(cpu_model()) << ", \"cpus\": " << online_cpus << "},\n";
+    std::cout << "  \"run\": {\"valid\": " << (run.valid ? "true" : "false")
+              << ", \"sort_seconds\": " << run.sort_seconds << ", \"validation_seconds\": " << run.validation_seconds
+              << ", \"keys_per_second\": " << keys_per_second << ", \"gb_per_second\": " << gb_per_second
+              << ", \"largest_bucket\": " << largest_bucket << ", \"imbalance\": " << imbalance
+              << ", \"target_bucket\": " << balance.target_bucket
+              << ", \"splitter_rounds\": " << sorter.splitter_rounds() << ", \"sample_size\": " << sorter.sample_size()
+              << ", \"oversampling\": " << sorter.oversampling()
+              << ", \"max_rank_error\": " << balance.max_rank_error
+              << ", \"phase4_bucket_correlation\": " << balance.phase4_correlation
+              << ", \"bytes_moved\": " << total_bytes_moved << ", \"peak_rss_kb\": " << run.peak_rss_kb << "},\n";
+    // Splitter i closes bucket i; its ideal rank is (i + 1) * N / p
+    const std::vector<size_t> ranks = sorter.splitter_ranks();
+    std::cout << "  \"splitters\": [";
+    for (size_t i = 0; i < ranks.size(); ++i) {
+        std::cout << (i > 0 ? ", " : "") << "{\"rank\": " << ranks[i] << ", \"rank_error\": " << balance.rank_errors[i] << "}";
     }
-    global_config.dataset.resize(global_config.total_elements);
-    for (size_t i = 0; i < global_config.total_elements; ++i) {
-        global_config.dataset[i] = unique_sequence[i] * unique_sequence[i];
+    std::cout << "],\n";
+    std::cout << "  \"workers\": [\n";
+    for (const auto& ctx : contexts) {
+        std::cout << "    {\"worker\": " << ctx.worker_id << ", \"phase1_seconds\": " << ctx.phase1_duration
+                  << ", \"phase2a_seconds\": " << ctx.phase2a_duration << ", \"phase2b_seconds\": " << ctx.phase2b_duration
+                  << ", \"phase3_seconds\": " << ctx.phase3_duration << ", \"phase4_seconds\": " << ctx.phase4_duration
+                  << ", \"chunk_size\": " << ctx.chunk_size << ", \"bucket_size\": " << ctx.bucket_size
+                  << ", \"equality_bucket\": " << (ctx.equality_bucket ? "true" : "false")
+                  << ", \"bytes_moved\": " << bytes_moved[ctx.worker_id]
+                  << ", \"heap_allocations\": " << std::accumulate(ctx.phase_allocations.begin(), ctx.phase_allocations.end(), uint64_t(0))
+                  << ", \"page_faults\": " << std::accumulate(ctx.phase_page_faults.begin(), ctx.phase_page_faults.end(), uint64_t(0));
+        // Barrier and lock waits per phase, keyed like "phase1"
+        std::cout << ", \"sync\": {";
+        for (int phase = 0; phase < hss::PhaseCount; ++phase) {
+            const hss::SyncCounters& sync = ctx.phase_sync[phase];
+            std::cout << (phase > 0 ? ", " : "") << quoted(phase_key(phase)) << ": {\"barrier_waits\": "
+                      << sync.barrier_waits << ", \"barrier_wait_seconds\": " << sync.barrier_wait_ns / 1e9
+                      << ", \"lock_acquisitions\": " << sync.lock_acquisitions
+                      << ", \"contended_lock_acquisitions\": " << sync.contended_acquisitions
+                      << ", \"lock_wait_seconds\": " << sync.lock_wait_ns / 1e9 << "}";
+        }
+        std::cout << "}";
+        // Hardware events per phase; only events every worker could count
+        if (std::any_of(counted.begin(), counted.end(), [](bool ok) { return ok; })) {
+            std::cout << ", \"counters\": {";
+            for (int phase = 0; phase < hss::PhaseCount; ++phase) {
+                std::cout << (phase > 0 ? ", " : "") << quoted(phase_key(phase)) << ": {";
+                bool first = true;
+                for (int event = 0; event < hss::EventCount; ++event) {
+                    if (!counted[event]) continue;
+                    std::string name = hss::event_name(event);
+                    std::replace(name.begin(), name.end(), ' ', '_');
+                    std::cout << (first ? "" : ", ") << quoted(name) << ": " << ctx.phase_events[phase][event];
+                    first = false;
+                }
+                std::cout << "}";
+            }
+            std::cout << "}";
+        }
+        std::cout << "}" << (ctx.worker_id + 1 < (int)contexts.size() ? "," : "") << "\n";
     }
-    std::mt19937 rng(global_config.random_seed);
-    std::shuffle(global_config.dataset.begin(), global_config.dataset.end(), rng);
+    std::cout << "  ]\n}\n";
+}
+
+// Write the sorter's timeline to --trace=<file>; the note goes to stderr so reports stay parseable
+template <typename Key>
+void write_trace_file(const Config& config, const hss::Sorter<Key>& sorter) {
+    if (config.trace_file.empty()) return;
+    std::ofstream out(config.trace_file);
+    sorter.write_trace(out);
+    size_t events = 0;
+    for (const auto& ctx : sorter.workers()) events += ctx.trace.size();
+    std::cerr << (out ? "Trace: " : "Trace: failed to write ") << config.trace_file << " (" << events
+              << " events; open in ui.perfetto.dev or chrome://tracing)\n";
+}
+
+// Generate, sort, validate and report for one key type
+template <typename Key>
+int run_typed(const Config& config) {
+    if constexpr (!std::is_same_v<Key, StringRef>) {
+        if (config.streaming) {
+            return run_streaming<Key>(config);
+        }
+    } else if (config.streaming) {
+        std::cerr << "--stream is not available with --type=string\n";
+        return 1;
+    }
+
+    // Time dataset generation
+    Dataset<Key> dataset;
+    dataset.keys = hss::Buffer<Key>(hss::BufferAllocator<Key>(config.huge_pages, config.populate));
+    auto start_dataset_gen = Clock::now();
+    generate_dataset(config, dataset);
     auto end_dataset_gen = Clock::now();
     double dataset_gen_time = Duration(end_dataset_gen - start_dataset_gen).count();
+    const KeyLess<Key> less = dataset.less();
 
-    if (global_config.total_elements <= 100) {
-        print_vector("Full dataset before sorting", global_config.dataset, true);
+    if (config.total_elements <= 100) {
+        hss::print_vector("Full dataset before sorting", dataset.keys, less);
+    }
+    // Only repeated sorts need a copy of the input; validation compares fingerprints
+    std::vector<Key> original;
+    if (config.repeat > 1) {
+        original.assign(dataset.keys.begin(), dataset.keys.end());
     }
 
-    // Time synchronization primitive initialization
+    // The peak resident set from here on covers the sorter's buffers and the sorts
+    const size_t resident_before_kb = status_kb("VmRSS");
+    const bool peak_reset = reset_peak_rss();
+
+    // Time sorter construction (synchronization primitives and buffers)
     auto start_sync_init = Clock::now();
-    // Initialize synchronization primitives
-    pthread_barrier_init(&global_config.barrier, nullptr, global_config.num_workers);
-    pthread_mutex_init(&global_config.lock, nullptr);
-    global_config.bucket_contributions.resize(global_config.num_workers);
-    global_config.bucket_locks.resize(global_config.num_workers);
-    for (auto& lock : global_config.bucket_locks) {
-        pthread_mutex_init(&lock, nullptr);
-    }
+    hss::Sorter<Key> sorter(make_options(config), less);
     auto end_sync_init = Clock::now();
     double sync_init_time = Duration(end_sync_init - start_sync_init).count();
 
+    // Multiset fingerprint of the input, taken in parallel before the sort overwrites it
+    auto start_fingerprint = Clock::now();
+    const hss::Fingerprint input_fingerprint = sorter.fingerprint(dataset.keys.data(), dataset.keys.size());
+    double validation_time = Duration(Clock::now() - start_fingerprint).count();
+
+    // Optionally size and fault in the workers' chunk and scratch buffers in parallel
+    double populate_time = 0.0;
+    if (config.populate) {
+        auto start_populate = Clock::now();
+        sorter.prepare(dataset.keys.size());
+        populate_time = Duration(Clock::now() - start_populate).count();
+    }
+
     // Time thread creation and algorithm execution
     auto total_start = Clock::now();
-    auto start_thread_creation = Clock::now();
-    std::vector<pthread_t> threads(global_config.num_workers);
-    std::vector<WorkerContext> contexts(global_config.num_workers);
-    for (int i = 0; i < global_config.num_workers; ++i) {
-        contexts[i].worker_id = i;
-        contexts[i].phase1_duration = 0.0;  // Initialize timing variables
-        contexts[i].phase2a_duration = 0.0;
-        contexts[i].phase2b_duration = 0.0;
-        contexts[i].phase3_duration = 0.0;
-        contexts[i].phase4_duration = 0.0;
-        pthread_create(&threads[i], nullptr, worker_function, &contexts[i]);
-    }
-    auto end_thread_creation = Clock::now();
-    double thread_creation_time = Duration(end_thread_creation - start_thread_creation).count();
-
-    // Wait for all threads to complete
-    for (auto& thread : threads) pthread_join(thread, nullptr);
+    sorter.sort(dataset.keys.data(), dataset.keys.size());
     auto total_end = Clock::now();
     double total_time = Duration(total_end - total_start).count();
+    const auto& contexts = sorter.workers();
+
+    // Per-phase heap allocations, page faults and TLB misses summed over workers
+    bool tlb_available = true;
+    auto phase_usage = [&]() {
+        std::array<std::array<uint64_t, 3>, hss::PhaseCount> usage{};
+        for (const auto& ctx : contexts) {
+            tlb_available = tlb_available && ctx.perf_counters.valid(hss::DtlbMisses);
+            for (int phase = 0; phase < hss::PhaseCount; ++phase) {
+                usage[phase][0] += ctx.phase_allocations[phase];
+                usage[phase][1] += ctx.phase_page_faults[phase];
+                usage[phase][2] += ctx.phase_events[phase][hss::DtlbMisses];
+            }
+        }
+        return usage;
+    };
+    const auto first_usage = phase_usage();
+
+    // Sort the same input again with the warm sorter; the reports describe the last sort
+    double repeat_time = 0.0;
+    for (int round = 1; round < config.repeat; ++round) {
+        std::copy(original.begin(), original.end(), dataset.keys.begin());
+        auto start_repeat = Clock::now();
+        sorter.sort(dataset.keys.data(), dataset.keys.size());
+        repeat_time = Duration(Clock::now() - start_repeat).count();
+    }
+    const size_t peak_kb = status_kb("VmHWM");
 
-    // Collect and validate results
-    std::vector<long long> sorted_result;
+    // Check that every element landed in some bucket
     size_t total_counted = 0;
+    size_t largest_bucket = 0;
+    int equality_buckets = 0;
     for (const auto& ctx : contexts) {
-        sorted_result.insert(sorted_result.end(),
-                             ctx.local_chunk.begin(), ctx.local_chunk.end());
-        total_counted += ctx.local_chunk.size();
-        debug_print("Worker " + std::to_string(ctx.worker_id) + 
-                    " contributed " + std::to_string(ctx.local_chunk.size()) + 
-                    " elements");
+        total_counted += ctx.bucket_size;
+        largest_bucket = std::max(largest_bucket, ctx.bucket_size);
+        equality_buckets += ctx.equality_bucket ? 1 : 0;
+        debug_print(config, "Worker " + std::to_string(ctx.worker_id) +
+                            " contributed " + std::to_string(ctx.bucket_size) +
+                            " elements");
     }
 
-    if (total_counted != global_config.total_elements) {
-        std::cerr << "CRITICAL: Lost " 
-                  << (global_config.total_elements - total_counted)
+    if (total_counted != config.total_elements) {
+        std::cerr << "CRITICAL: Lost "
+                  << (config.total_elements - total_counted)
                   << " elements!\n";
         return 1;
     }
 
-    // Validate sorting
-    std::sort(sorted_result.begin(), sorted_result.end());
-    std::vector<long long> sorted_original = global_config.dataset;
-    std::sort(sorted_original.begin(), sorted_original.end());
-    const bool is_valid = (sorted_result == sorted_original);
-    std::cout << "Validation: " 
-              << (is_valid ? "Sorted correctly!" : "Sorting failed!") 
+    // Validate in parallel: the output is in order and holds the same multiset as the input
+    auto start_validation = Clock::now();
+    const bool is_valid = sorter.is_sorted(dataset.keys.data(), dataset.keys.size()) &&
+                          sorter.fingerprint(dataset.keys.data(), dataset.keys.size()) == input_fingerprint;
+    validation_time += Duration(Clock::now() - start_validation).count();
+    if (!config.report.empty()) {
+        print_structured_report(config, sorter, {is_valid, config.repeat > 1 ? repeat_time : total_time,
+                                                 validation_time, peak_reset ? peak_kb : 0});
+        write_trace_file(config, sorter);
+        return is_valid ? 0 : 1;
+    }
+    std::cout << "Validation: "
+              << (is_valid ? "Sorted correctly!" : "Sorting failed!")
               << "\n";
-    if (global_config.verbose_output) {
-        print_vector("Final sorted output", sorted_result, true);
+    if (config.verbose_output) {
+        hss::print_vector("Final sorted output", dataset.keys, less);
     }
 
     // Compute and display timing results for algorithm phases
@@ -298,10 +879,21 @@ int main(int argc, char* argv[]) {
     double estimated_total = max_phase1 + total_phase2 + max_phase3 + max_phase4;
 
     // Display initialization timing results
+    std::cout << "\nKey Type: " << config.key_type << " (" << sizeof(Key)
+              << " bytes, " << hss::backend_name<Key>(config.in_place, config.stable) << " backend"
+              << (config.stable ? ", stable" : "") << (config.in_place ? ", in place" : "") << ")\n";
+    const double average_bucket = static_cast<double>(config.total_elements) / contexts.size();
+    std::cout << "Distribution: " << config.distribution << "\n";
+    std::cout << "Largest Bucket: " << largest_bucket << " elements ("
+              << (average_bucket > 0 ? largest_bucket / average_bucket : 0.0) << "x average, "
+              << equality_buckets << " equality buckets)\n";
     std::cout << "\nInitialization Timing:\n";
     std::cout << "Dataset Generation: " << dataset_gen_time << " seconds\n";
     std::cout << "Synchronization Primitive Initialization: " << sync_init_time << " seconds\n";
-    std::cout << "Thread Creation: " << thread_creation_time << " seconds\n";
+    std::cout << "Thread Creation: " << sorter.pool_startup_duration() << " seconds\n";
+    if (config.populate) {
+        std::cout << "Buffer Pre-population (parallel): " << populate_time << " seconds\n";
+    }
 
     // Display algorithm timing results
     std::cout << "\nAlgorithm Timing Results:\n";
@@ -313,12 +905,1279 @@ int main(int argc, char* argv[]) {
     std::cout << "Phase 4 (Final Sorting): " << max_phase4 << " seconds\n";
     std::cout << "Estimated Total Sorting Time (sum of phases): " << estimated_total << " seconds\n";
     std::cout << "Measured Total Time (including thread creation): " << total_time << " seconds\n";
+    if (config.repeat > 1) {
+        std::cout << "Last of " << config.repeat << " Sorts (warm sorter): " << repeat_time << " seconds\n";
+    }
+    std::cout << "Validation (parallel sortedness and multiset fingerprint): " << validation_time << " seconds\n";
+    print_balance(config, sorter);
 
-    // Cleanup synchronization primitives
-    pthread_barrier_destroy(&global_config.barrier);
-    pthread_mutex_destroy(&global_config.lock);
-    for (auto& lock : global_config.bucket_locks) {
-        pthread_mutex_destroy(&lock);
+    // Allocations come from the counting operator new, page faults from getrusage and
+    // TLB misses from perf_event (Linux)
+    const auto last_usage = phase_usage();
+    auto print_usage = [&](const std::array<uint64_t, 3>& usage) {
+        std::cout << usage[0] << " / " << usage[1] << " / ";
+        if (tlb_available) {
+            std::cout << usage[2];
+        } else {
+            std::cout << "n/a";
+        }
+    };
+    std::cout << "\nMemory per Phase (heap allocations / page faults / dTLB load misses, all workers):\n";
+    for (int phase = 0; phase < hss::PhaseCount; ++phase) {
+        std::cout << hss::phase_name(phase) << ": first sort ";
+        print_usage(first_usage[phase]);
+        if (config.repeat > 1) {
+            std::cout << ", sort " << config.repeat << " ";
+            print_usage(last_usage[phase]);
+        }
+        std::cout << "\n";
+    }
+    std::cout << "Huge Pages: " << huge_pages_name(config.huge_pages) << " (" << anon_huge_pages_kb()
+              << " kB of anonymous memory in huge pages)\n";
+    if (peak_reset && peak_kb > 0) {
+        // Everything above the resident set before the sorter was built is the sorter's
+        const double input_mb = config.total_elements * sizeof(Key) / 1048576.0;
+        const double added_mb = (peak_kb - std::min(peak_kb, resident_before_kb)) / 1024.0;
+        std::cout << "Peak RSS: " << peak_kb / 1024.0 << " MB (" << resident_before_kb / 1024.0
+                  << " MB before sorting, input " << input_mb << " MB; the sorter added " << added_mb
+                  << " MB = " << (input_mb > 0 ? added_mb / input_mb : 0.0) << "x the input)\n";
     }
+    print_synchronization(contexts, config.repeat > 1 ? repeat_time : total_time);
+    print_hardware_counters(contexts);
+    write_trace_file(config, sorter);
     return 0;
-}
\ No newline at end of file
+}
+
+// Largest duration of a phase over workers (the leader's for Phase 2b)
+template <typename Worker>
+std::array<double, hss::PhaseCount> max_phase_durations(const std::vector<Worker>& workers) {
+    std::array<double, hss::PhaseCount> durations{};
+    for (const auto& worker : workers) {
+        const double phases[hss::PhaseCount] = {worker.phase1_duration, worker.phase2a_duration,
+                                                worker.phase2b_duration, worker.phase3_duration,
+                                                worker.phase4_duration};
+        for (int phase = 0; phase < hss::PhaseCount; ++phase) durations[phase] = std::max(durations[phase], phases[phase]);
+    }
+    return durations;
+}
+
+// --processes: sort with one forked process per worker on a shared-memory segment, then sort
+// the same input with the thread pool, and compare the two phase by phase. The thread sorter
+// is built after the process sorts, so the workers are forked from a single-threaded process
+template <typename Key>
+int run_processes(const Config& config) {
+    Dataset<Key> dataset;
+    dataset.keys = hss::Buffer<Key>(hss::BufferAllocator<Key>(config.huge_pages, config.populate));
+    generate_dataset(config, dataset);
+    const KeyLess<Key> less = dataset.less();
+    const std::vector<Key> original(dataset.keys.begin(), dataset.keys.end());
+
+    hss::ProcessSorter<Key> processes(make_options(config), less);
+    double process_time = 0.0;
+    for (int round = 0; round < config.repeat; ++round) {
+        std::copy(original.begin(), original.end(), dataset.keys.begin());
+        auto start_sort = Clock::now();
+        try {
+            processes.sort(dataset.keys.data(), dataset.keys.size());
+        } catch (const std::exception& error) {
+            std::cerr << error.what() << "\n";
+            return 1;
+        }
+        process_time = Duration(Clock::now() - start_sort).count();
+    }
+
+    // Validate both outputs on the thread sorter's pool
+    hss::Sorter<Key> threads(make_options(config), less);
+    const hss::Fingerprint input_fingerprint = threads.fingerprint(original.data(), original.size());
+    const bool processes_valid = threads.is_sorted(dataset.keys.data(), dataset.keys.size()) &&
+                                 threads.fingerprint(dataset.keys.data(), dataset.keys.size()) == input_fingerprint;
+    double thread_time = 0.0;
+    for (int round = 0; round < config.repeat; ++round) {
+        std::copy(original.begin(), original.end(), dataset.keys.begin());
+        auto start_sort = Clock::now();
+        threads.sort(dataset.keys.data(), dataset.keys.size());
+        thread_time = Duration(Clock::now() - start_sort).count();
+    }
+    const bool threads_valid = threads.is_sorted(dataset.keys.data(), dataset.keys.size()) &&
+                               threads.fingerprint(dataset.keys.data(), dataset.keys.size()) == input_fingerprint;
+    std::cout << "Validation: " << (processes_valid && threads_valid ? "Sorted correctly!" : "Sorting failed!") << "\n";
+
+    const auto& workers = processes.workers();
+    std::cout << "\nKey Type: " << config.key_type << " (" << sizeof(Key) << " bytes, " << hss::backend_name<Key>()
+              << " backend)\n";
+    std::cout << "Distribution: " << config.distribution << "\n";
+    std::cout << "Processes: " << processes.num_workers() << " forked workers on a "
+              << processes.segment_bytes() / 1048576.0 << " MB shared-memory segment (" << processes.oversampling()
+              << " samples per bucket)\n";
+    std::cout << "Forking: " << processes.fork_duration() << " seconds\n";
+    std::cout << "Copy into and out of the segment: " << processes.copy_duration() << " seconds\n";
+
+    const auto process_phases = max_phase_durations(workers);
+    const auto thread_phases = max_phase_durations(threads.workers());
+    std::cout << "\nAlgorithm Timing Results (" << (config.repeat > 1 ? "last sort; " : "")
+              << "processes / threads, seconds):\n";
+    for (int phase = 0; phase < hss::PhaseCount; ++phase) {
+        std::cout << hss::phase_name(phase) << ": " << process_phases[phase] << " / " << thread_phases[phase] << "\n";
+    }
+    std::cout << "Measured Total Time: " << process_time << " / " << thread_time
+              << " (processes include forking and copying)\n";
+
+    std::cout << "\nPer worker process (page faults over all phases, barrier wait):\n";
+    for (const hss::ProcessWorker& worker : workers) {
+        uint64_t barrier_wait_ns = 0;
+        for (const hss::SyncCounters& sync : worker.phase_sync) barrier_wait_ns += sync.barrier_wait_ns;
+        std::cout << "Worker " << worker.worker_id << ": chunk " << worker.chunk_size << ", bucket "
+                  << worker.bucket_size << ", "
+                  << std::accumulate(worker.phase_page_faults.begin(), worker.phase_page_faults.end(), uint64_t(0))
+                  << " page faults, " << barrier_wait_ns / 1e9 << " seconds\n";
+    }
+    return processes_valid && threads_valid ? 0 : 1;
+}
+
+// --range / --topk: order only output ranks [lo, hi) of the generated input, then fully sort
+// the same input with the same sorter and compare the range element by element. Both runs
+// are timed phase by phase to show what skipping the rest of the keys saves
+template <typename Key>
+int run_partial(const Config& config) {
+    Dataset<Key> dataset;
+    dataset.keys = hss::Buffer<Key>(hss::BufferAllocator<Key>(config.huge_pages, config.populate));
+    generate_dataset(config, dataset);
+    const KeyLess<Key> less = dataset.less();
+    const std::vector<Key> original(dataset.keys.begin(), dataset.keys.end());
+    const size_t n = original.size();
+    const size_t lo = std::min(config.range_begin, n);
+    const size_t hi = std::min(std::max(config.range_end, lo), n);
+
+    hss::Sorter<Key> sorter(make_options(config), less);
+    double partial_time = 0.0;
+    for (int round = 0; round < config.repeat; ++round) {
+        std::copy(original.begin(), original.end(), dataset.keys.begin());
+        auto start_sort = Clock::now();
+        sorter.sort_range(dataset.keys.data(), n, lo, hi);
+        partial_time = Duration(Clock::now() - start_sort).count();
+    }
+    const std::vector<Key> range(dataset.keys.begin() + lo, dataset.keys.begin() + hi);
+    const auto partial_phases = max_phase_durations(sorter.workers());
+    // Buckets of the partial sort, before the full sort reuses the workers
+    struct Bucket {
+        size_t size;
+        size_t sorted;
+        double phase4_duration;
+        bool equality;
+    };
+    std::vector<Bucket> buckets;
+    for (const auto& ctx : sorter.workers()) {
+        buckets.push_back({ctx.bucket_size, ctx.sorted_size, ctx.phase4_duration, ctx.equality_bucket});
+    }
+    const size_t kept = sorter.kept_size();
+    const size_t kept_offset = sorter.kept_offset();
+    const bool fallback = sorter.range_fallback();
+
+    const hss::Fingerprint input_fingerprint = sorter.fingerprint(original.data(), n);
+    double full_time = 0.0;
+    for (int round = 0; round < config.repeat; ++round) {
+        std::copy(original.begin(), original.end(), dataset.keys.begin());
+        auto start_sort = Clock::now();
+        sorter.sort(dataset.keys.data(), n);
+        full_time = Duration(Clock::now() - start_sort).count();
+    }
+    const auto full_phases = max_phase_durations(sorter.workers());
+    const bool full_valid = sorter.is_sorted(dataset.keys.data(), n) &&
+                            sorter.fingerprint(dataset.keys.data(), n) == input_fingerprint;
+    bool range_valid = true;
+    for (size_t i = 0; i < range.size() && range_valid; ++i) {
+        const Key& expected = dataset.keys[lo + i];
+        range_valid = !less(range[i], expected) && !less(expected, range[i]);
+    }
+    const bool valid = full_valid && range_valid;
+    std::cout << "Validation: " << (valid ? "Sorted correctly!" : "Sorting failed!")
+              << (full_valid && !range_valid ? " (range differs from the full sort)" : "") << "\n";
+
+    std::cout << "\nKey Type: " << config.key_type << " (" << sizeof(Key) << " bytes, " << hss::backend_name<Key>(config.in_place, config.stable)
+              << " backend" << (config.stable ? ", stable" : "") << (config.in_place ? ", in place" : "") << ")\n";
+    std::cout << "Distribution: " << config.distribution << "\n";
+    std::cout << "Range: ranks [" << lo << ", " << hi << ") of " << n << " ("
+              << (n > 0 ? 100.0 * (hi - lo) / n : 0.0) << "% of the keys)\n";
+    std::cout << "Kept by Phase 1: " << kept << " keys from rank " << kept_offset
+              << (fallback ? " (sampled bounds missed the range, every key kept)"
+                           : config.in_place ? " (in place keeps every key)" : "")
+              << "\n";
+    int buckets_in_range = 0;
+    size_t sorted = 0;
+    for (const Bucket& bucket : buckets) {
+        buckets_in_range += bucket.sorted > 0 ? 1 : 0;
+        sorted += bucket.sorted;
+    }
+    std::cout << "Buckets in Range: " << buckets_in_range << " of " << buckets.size() << " (" << sorted
+              << " keys ordered in Phase 4)\n";
+
+    std::cout << "\nAlgorithm Timing Results (" << (config.repeat > 1 ? "last sort; " : "")
+              << "partial / full sort, seconds):\n";
+    for (int phase = 0; phase < hss::PhaseCount; ++phase) {
+        std::cout << hss::phase_name(phase) << ": " << partial_phases[phase] << " / " << full_phases[phase] << "\n";
+    }
+    std::cout << "Measured Total Time: " << partial_time << " / " << full_time << " ("
+              << (full_time > 0 ? 100.0 * partial_time / full_time : 0.0) << "% of the full sort)\n";
+
+    std::cout << "\nPer bucket of the partial sort (size, keys in range, Phase 4 time):\n";
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        std::cout << "Bucket " << i << ": " << buckets[i].size << ", " << buckets[i].sorted << ", "
+                  << buckets[i].phase4_duration << " seconds"
+                  << (buckets[i].equality ? " (equality bucket, not sorted)" : "") << "\n";
+    }
+    return valid ? 0 : 1;
+}
+
+// One rank of --distributed: sort this rank's slice of the generated input with the others,
+// validate collectively, and let rank 0 report. Every rank holds the whole generated dataset
+// (string arenas then match across ranks) and keeps slice [r N/p, (r + 1) N/p) of it
+template <typename Key>
+bool run_rank(const Config& config, hss::Transport& transport, const Dataset<Key>& dataset, const char* backend) {
+    const int p = transport.size();
+    const int rank = transport.rank();
+    const size_t n = dataset.keys.size();
+    const std::vector<Key> slice(dataset.keys.begin() + n * rank / p, dataset.keys.begin() + n * (rank + 1) / p);
+    hss::DistributedSorter<Key> sorter(transport, make_options(config), dataset.less());
+    const hss::Fingerprint input_fingerprint = sorter.fingerprint(slice.data(), slice.size());
+
+    // Time of the last of config.repeat sorts of the slice; keys holds the result
+    std::vector<Key> keys;
+    auto timed_sorts = [&](hss::DistributedSorter<Key>& distributed) {
+        double sort_time = 0.0;
+        for (int round = 0; round < config.repeat; ++round) {
+            keys = slice;
+            transport.barrier();
+            auto start_sort = Clock::now();
+            distributed.sort(keys);
+            transport.barrier();
+            sort_time = Duration(Clock::now() - start_sort).count();
+        }
+        return sort_time;
+    };
+
+    // --compress: the same sorts without compression first, as the end-to-end baseline
+    double baseline_time = 0.0;
+    std::vector<hss::DistributedStats> baseline;
+    if (config.compress) {
+        hss::Options options = make_options(config);
+        options.compress_exchange = false;
+        hss::DistributedSorter<Key> uncompressed(transport, options, dataset.less());
+        baseline_time = timed_sorts(uncompressed);
+        baseline = uncompressed.gather_stats();
+    }
+    const double sort_time = timed_sorts(sorter);
+    const bool valid = sorter.is_sorted(keys.data(), keys.size()) &&
+                       sorter.fingerprint(keys.data(), keys.size()) == input_fingerprint;
+    const std::vector<hss::DistributedStats> ranks = sorter.gather_stats();
+    if (rank != 0) return valid;
+
+    const hss::DistributedStats& first = ranks.front();
+    const uint64_t total = sorter.global_size();
+    size_t largest = 0;
+    uint64_t bytes_sent = 0, pieces_sent = 0;
+    for (const hss::DistributedStats& stats : ranks) {
+        largest = std::max(largest, stats.bucket_size);
+        bytes_sent += stats.bytes_sent;
+        pieces_sent += stats.pieces_sent;
+    }
+    uint64_t max_rank_error = 0;
+    for (size_t i = 0; i < sorter.splitter_ranks().size(); ++i) {
+        const uint64_t target = sorter.splitter_targets()[i], actual = sorter.splitter_ranks()[i];
+        max_rank_error = std::max(max_rank_error, actual > target ? actual - target : target - actual);
+    }
+    const int groups = hss::rank_groups(p, config.levels);
+    std::cout << "Validation: " << (valid ? "Sorted correctly!" : "Sorting failed!") << "\n";
+    std::cout << "\nKey Type: " << config.key_type << " (" << sizeof(Key) << " bytes, " << hss::backend_name<Key>()
+              << " backend)\n";
+    std::cout << "Distribution: " << config.distribution << "\n";
+    std::cout << "Transport: " << backend << ", " << p << " ranks\n";
+    if (groups < p) {
+        std::cout << "Levels: " << first.levels << " (" << groups << " groups of ranks at the top)\n";
+    } else {
+        std::cout << "Levels: 1 (flat)\n";
+    }
+    std::cout << "Histogramming (rank 0, all levels): " << first.rounds << (first.rounds == 1 ? " round, " : " rounds, ")
+              << first.samples << " samples (" << sorter.oversampling()
+              << " per open splitter per round), max top-level splitter rank error " << max_rank_error
+              << " (tolerance " << sorter.splitter_tolerance() << ")\n";
+    std::cout << "Largest Bucket: " << largest << " keys (Imbalance: "
+              << (total > 0 ? static_cast<double>(largest) * p / total : 0.0) << ")\n";
+    std::cout << "Exchange: " << bytes_sent / 1048576.0 << " MB in " << pieces_sent << " pieces sent between ranks\n";
+    if (config.compress) {
+        uint64_t key_bytes = 0;
+        double encode = 0.0, decode = 0.0;
+        for (const hss::DistributedStats& stats : ranks) {
+            key_bytes += stats.key_bytes_sent;
+            encode = std::max(encode, stats.encode_duration);
+            decode = std::max(decode, stats.decode_duration);
+        }
+        const double baseline_phase3 = max_phase_durations(baseline)[hss::Phase3];
+        std::cout << "Compression: " << (bytes_sent > 0 ? static_cast<double>(key_bytes) / bytes_sent : 1.0)
+                  << "x (" << key_bytes / 1048576.0 << " MB of keys), encoding " << encode << " seconds, decoding "
+                  << decode << " seconds (max over ranks)\n";
+        std::cout << "Uncompressed: Phase 3 " << baseline_phase3 << " seconds, total " << baseline_time
+                  << " seconds\n";
+        std::cout << "Paid off end-to-end: " << (sort_time < baseline_time ? "yes" : "no") << " ("
+                  << std::abs(baseline_time - sort_time) << " seconds " << (sort_time < baseline_time ? "saved" : "lost")
+                  << ")\n";
+    }
+
+    const auto phases = max_phase_durations(ranks);
+    std::cout << "\nAlgorithm Timing Results (" << (config.repeat > 1 ? "last sort; " : "")
+              << (groups < p ? "max over ranks of the sum over levels" : "max over ranks") << ", seconds):\n";
+    std::cout << "Phase 1 (Local Sorting): " << phases[hss::Phase1] << " seconds\n";
+    std::cout << "Phase 2a (Interval Sampling and Gather): " << phases[hss::Phase2a] << " seconds\n";
+    std::cout << "Phase 2b (Histogram All-Reduce): " << phases[hss::Phase2b] << " seconds\n";
+    std::cout << "Phase 3 (All-to-All Exchange): " << phases[hss::Phase3] << " seconds\n";
+    std::cout << "Phase 4 (Final Sorting): " << phases[hss::Phase4] << " seconds\n";
+    std::cout << "Measured Total Time: " << sort_time << " seconds\n";
+
+    std::cout << "\nPer rank (input, bucket, pieces sent, MB sent):\n";
+    for (const hss::DistributedStats& stats : ranks) {
+        std::cout << "Rank " << stats.rank << ": " << stats.input_size << ", " << stats.bucket_size << ", "
+                  << stats.pieces_sent << ", " << stats.bytes_sent / 1048576.0 << "\n";
+    }
+    return valid;
+}
+
+// --distributed: <workers> ranks forked on this machine over Unix-domain sockets, or the ranks
+// of the MPI job (--distributed=mpi, started with mpirun; <workers> is then ignored). Local ranks
+// inherit the dataset generated here; MPI ranks each generate it from the seed
+template <typename Key>
+int run_distributed(const Config& config) {
+    Dataset<Key> dataset;
+    generate_dataset(config, dataset);
+#ifdef HSS_MPI
+    if (config.distributed == "mpi") {
+        try {
+            hss::MpiTransport transport;
+            return run_rank(config, transport, dataset, "MPI") ? 0 : 1;
+        } catch (const std::exception& error) {
+            std::cerr << error.what() << "\n";
+            return 1;
+        }
+    }
+#endif
+    try {
+        const bool valid = hss::run_local_ranks(config.num_workers, [&](hss::Transport& transport) {
+            return run_rank(config, transport, dataset, "local (Unix-domain sockets)");
+        });
+        return valid ? 0 : 1;
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+}
+
+// Payload sorting strategies for --payload-strategy=
+constexpr int PAYLOAD_MOVE = 1;         // Move full records through the exchange
+constexpr int PAYLOAD_PERMUTE = 2;      // Sort (key, row) pairs, then gather payload columns
+
+// Deterministic payload for a row: row id in the first bytes, a row-dependent pattern after it
+template <size_t PayloadBytes>
+void fill_payload(std::array<uint8_t, PayloadBytes>& payload, uint64_t row) {
+    std::memcpy(payload.data(), &row, std::min(PayloadBytes, sizeof(row)));
+    for (size_t i = sizeof(row); i < PayloadBytes; ++i) {
+        payload[i] = static_cast<uint8_t>(row * 31 + i);
+    }
+}
+
+// Check that keys come out sorted and each payload still belongs to its key's original row
+template <size_t PayloadBytes, typename GetKey, typename GetPayload>
+bool validate_payload(const std::vector<long long>& keys, GetKey get_key, GetPayload get_payload) {
+    std::vector<bool> seen(keys.size(), false);
+    std::array<uint8_t, PayloadBytes> expected;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i > 0 && get_key(i) < get_key(i - 1)) return false;
+        const auto& payload = get_payload(i);
+        uint64_t row = 0;
+        std::memcpy(&row, payload.data(), std::min(PayloadBytes, sizeof(row)));
+        if (row >= keys.size() || seen[row] || keys[row] != get_key(i)) return false;
+        fill_payload(expected, row);
+        if (payload != expected) return false;
+        seen[row] = true;
+    }
+    return true;
+}
+
+// Key-value mode: sort 64-bit keys carrying a PayloadBytes payload with either strategy
+template <size_t PayloadBytes>
+int run_payload(const Config& config, int strategies) {
+    using Payload = std::array<uint8_t, PayloadBytes>;
+    using Record = KeyValue<Payload>;
+    using KeyIndex = KeyValue<uint64_t>;
+    const size_t n = config.total_elements;
+
+    // Struct-of-arrays input: a key column and a payload column
+    std::vector<long long> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = make_key<long long>(i + 1);
+    }
+    std::mt19937 rng(config.random_seed);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    std::vector<Payload> payloads(n);
+    for (size_t row = 0; row < n; ++row) {
+        fill_payload(payloads[row], row);
+    }
+
+    // Both strategies are timed from the input columns to sorted output columns
+    double move_records_time = 0.0, move_sort_time = 0.0, move_scatter_time = 0.0, move_time = 0.0;
+    bool move_valid = true;
+    if (strategies & PAYLOAD_MOVE) {
+        auto start_move = Clock::now();
+        std::vector<Record> sorted_records(n);
+        for (size_t row = 0; row < n; ++row) {
+            sorted_records[row] = {keys[row], payloads[row]};
+        }
+        auto end_records = Clock::now();
+
+        // Records are sorted in place; Phase 4 writes each bucket back to its output range
+        hss::Sorter<Record> sorter(make_options(config));
+        sorter.sort(sorted_records.data(), n);
+        auto end_sort = Clock::now();
+
+        // Parallel split of the sorted records back into columns on the sorter's pool
+        std::vector<long long> sorted_keys(n);
+        std::vector<Payload> sorted_payloads(n);
+        const int total_workers = sorter.num_workers();
+        sorter.for_each_worker([&](int worker_id) {
+            const size_t begin = n * worker_id / total_workers;
+            const size_t end = n * (worker_id + 1) / total_workers;
+            for (size_t out = begin; out < end; ++out) {
+                sorted_keys[out] = sorted_records[out].key;
+                sorted_payloads[out] = sorted_records[out].value;
+            }
+        });
+        auto end_move = Clock::now();
+        move_records_time = Duration(end_records - start_move).count();
+        move_sort_time = Duration(end_sort - end_records).count();
+        move_scatter_time = Duration(end_move - end_sort).count();
+        move_time = Duration(end_move - start_move).count();
+
+        move_valid = validate_payload<PayloadBytes>(
+            keys, [&](size_t i) { return sorted_keys[i]; },
+            [&](size_t i) -> const Payload& { return sorted_payloads[i]; });
+    }
+
+    double permute_pairs_time = 0.0, permute_sort_time = 0.0, permute_gather_time = 0.0, permute_time = 0.0;
+    bool permute_valid = true;
+    if (strategies & PAYLOAD_PERMUTE) {
+        auto start_permute = Clock::now();
+        std::vector<KeyIndex> pairs(n);
+        for (size_t row = 0; row < n; ++row) {
+            pairs[row] = {keys[row], row};
+        }
+        auto end_pairs = Clock::now();
+
+        hss::Sorter<KeyIndex> sorter(make_options(config));
+        sorter.sort(pairs.data(), n);
+        auto end_sort = Clock::now();
+
+        // Parallel gather on the sorter's pool: each worker applies an equal slice of the permutation
+        std::vector<long long> sorted_keys(n);
+        std::vector<Payload> sorted_payloads(n);
+        const int total_workers = sorter.num_workers();
+        sorter.for_each_worker([&](int worker_id) {
+            const size_t begin = n * worker_id / total_workers;
+            const size_t end = n * (worker_id + 1) / total_workers;
+            for (size_t out = begin; out < end; ++out) {
+                sorted_keys[out] = pairs[out].key;
+                sorted_payloads[out] = payloads[pairs[out].value];
+            }
+        });
+        auto end_permute = Clock::now();
+        permute_pairs_time = Duration(end_pairs - start_permute).count();
+        permute_sort_time = Duration(end_sort - end_pairs).count();
+        permute_gather_time = Duration(end_permute - end_sort).count();
+        permute_time = Duration(end_permute - start_permute).count();
+
+        permute_valid = validate_payload<PayloadBytes>(
+            keys, [&](size_t i) { return sorted_keys[i]; },
+            [&](size_t i) -> const Payload& { return sorted_payloads[i]; });
+    }
+
+    const bool is_valid = move_valid && permute_valid;
+    std::cout << "Validation: " 
+              << (is_valid ? "Sorted correctly!" : "Sorting failed!") 
+              << "\n";
+
+    std::cout << "\nPayload Sorting (" << n << " records, 8-byte key + " << PayloadBytes
+              << "-byte payload):\n";
+    if (strategies & PAYLOAD_MOVE) {
+        std::cout << "Move Records (" << sizeof(Record) << "-byte records through the exchange): "
+                  << move_time << " seconds\n";
+        std::cout << "  - Record Construction: " << move_records_time << " seconds\n";
+        std::cout << "  - HSS: " << move_sort_time << " seconds\n";
+        std::cout << "  - Parallel Split into Columns: " << move_scatter_time << " seconds\n";
+    }
+    if (strategies & PAYLOAD_PERMUTE) {
+        std::cout << "Sort Pairs + Gather (" << sizeof(KeyIndex) << "-byte key/row pairs through the exchange): "
+                  << permute_time << " seconds\n";
+        std::cout << "  - Pair Construction: " << permute_pairs_time << " seconds\n";
+        std::cout << "  - HSS: " << permute_sort_time << " seconds\n";
+        std::cout << "  - Parallel Gather: " << permute_gather_time << " seconds\n";
+    }
+    if (strategies == (PAYLOAD_MOVE | PAYLOAD_PERMUTE)) {
+        const bool move_wins = move_time <= permute_time;
+        std::cout << "Winner at " << PayloadBytes << " bytes: "
+                  << (move_wins ? "move records" : "sort pairs + gather") << " ("
+                  << (move_wins ? permute_time / move_time : move_time / permute_time) << "x)\n";
+    }
+
+    return is_valid ? 0 : 1;
+}
+
+// Timing statistics of one benchmark configuration
+struct BenchResult {
+    std::string key_type;
+    std::string distribution;
+    std::string scaling;                // "strong" (fixed N) or "weak" (fixed N/p)
+    int workers;
+    size_t elements;
+    double median;                      // Sort times in seconds over the measured sorts
+    double p10;
+    double p90;
+    double ci95;                        // Half-width of the 95% confidence interval of the mean
+    bool valid;
+    // Median times of the baselines on the same input (0 when not run)
+    double std_sort;                    // Serial std::sort
+    double par_unseq;                   // std::sort(std::execution::par_unseq, ...)
+    double merge_sort;                  // Parallel merge sort on p workers
+    double sample_sort;                 // Sample sort without histogramming on p workers
+};
+
+// Baseline: parallel merge sort. Every worker sorts a slice, then adjacent runs are merged
+// pairwise in log2(p) rounds, alternating between data and buffer; the last merge is serial
+template <typename Key, typename Less>
+void parallel_merge_sort(hss::Sorter<Key, Less>& pool, Key* data, size_t n, std::vector<Key>& buffer) {
+    const int p = pool.num_workers();
+    const Less& less = pool.less();
+    buffer.resize(n);
+    auto bound = [&](int worker_id) { return n * std::min(worker_id, p) / p; };
+    pool.for_each_worker([&](int worker_id) {
+        std::sort(data + bound(worker_id), data + bound(worker_id + 1), less);
+    });
+    Key* from = data;
+    Key* to = buffer.data();
+    for (int width = 1; width < p; width *= 2) {
+        pool.for_each_worker([&](int worker_id) {
+            if (worker_id % (2 * width) != 0) return;
+            const size_t begin = bound(worker_id);
+            const size_t middle = bound(worker_id + width);
+            const size_t end = bound(worker_id + 2 * width);
+            std::merge(from + begin, from + middle, from + middle, from + end, to + begin, less);
+        });
+        std::swap(from, to);
+    }
+    if (from != data) {
+        pool.for_each_worker([&](int worker_id) {
+            std::copy(from + bound(worker_id), from + bound(worker_id + 1), data + bound(worker_id));
+        });
+    }
+}
+
+// Buffers of the sample sort baseline, kept across sorts
+template <typename Key>
+struct SampleSortBuffers {
+    std::vector<Key> buffer;            // Scatter target
+    std::vector<int> oracle;            // Bucket of every element
+    std::vector<Key> splitters;
+    std::vector<size_t> counts;         // counts[w * p + b]: elements of worker w's slice in bucket b
+};
+
+// Baseline: classic sample sort without histogramming. Splitters come from one round of
+// random samples of the unsorted input, compared by key only (no tie-breaking, so a hot key
+// lands in one bucket). Each element is classified by binary search and scattered to its
+// bucket, and every worker sorts one bucket
+template <typename Key, typename Less>
+void sample_sort(hss::Sorter<Key, Less>& pool, Key* data, size_t n, SampleSortBuffers<Key>& state, int seed) {
+    const int p = pool.num_workers();
+    const Less& less = pool.less();
+    state.buffer.resize(n);
+    state.oracle.resize(n);
+    state.counts.assign(p * p, 0);
+    state.splitters.clear();
+    if (n == 0) return;
+
+    // Same oversampling as HSS: s samples per bucket for p buckets
+    const hss::Options& options = pool.options();
+    const size_t oversampling = options.oversampling > 0 ? options.oversampling
+                                                         : hss::oversampling_ratio(n, p, options.max_imbalance);
+    std::vector<Key> samples;
+    std::mt19937_64 rng(seed);
+    for (size_t i = 0; i < oversampling * p; ++i) {
+        samples.push_back(data[rng() % n]);
+    }
+    std::sort(samples.begin(), samples.end(), less);
+    for (int b = 1; b < p; ++b) {
+        state.splitters.push_back(samples[b * samples.size() / p]);
+    }
+
+    auto bound = [&](int worker_id) { return n * worker_id / p; };
+    pool.for_each_worker([&](int worker_id) {
+        size_t* counts = state.counts.data() + worker_id * p;
+        for (size_t i = bound(worker_id); i < bound(worker_id + 1); ++i) {
+            const int bucket = std::upper_bound(state.splitters.begin(), state.splitters.end(), data[i], less) -
+                               state.splitters.begin();
+            state.oracle[i] = bucket;
+            counts[bucket]++;
+        }
+    });
+
+    // Turn the counts into scatter offsets: bucket-major, then source worker
+    std::vector<size_t> bucket_begin(p + 1, 0);
+    size_t offset = 0;
+    for (int b = 0; b < p; ++b) {
+        bucket_begin[b] = offset;
+        for (int w = 0; w < p; ++w) {
+            const size_t count = state.counts[w * p + b];
+            state.counts[w * p + b] = offset;
+            offset += count;
+        }
+    }
+    bucket_begin[p] = n;
+
+    pool.for_each_worker([&](int worker_id) {
+        size_t* offsets = state.counts.data() + worker_id * p;
+        for (size_t i = bound(worker_id); i < bound(worker_id + 1); ++i) {
+            state.buffer[offsets[state.oracle[i]]++] = data[i];
+        }
+    });
+    pool.for_each_worker([&](int worker_id) {
+        Key* begin = state.buffer.data() + bucket_begin[worker_id];
+        Key* end = state.buffer.data() + bucket_begin[worker_id + 1];
+        std::sort(begin, end, less);
+        std::copy(begin, end, data + bucket_begin[worker_id]);
+    });
+}
+
+// Percentile q in [0, 1] of sorted samples, interpolating between ranks
+double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    const double rank = q * (sorted.size() - 1);
+    const size_t below = static_cast<size_t>(rank);
+    const size_t above = std::min(below + 1, sorted.size() - 1);
+    return sorted[below] + (rank - below) * (sorted[above] - sorted[below]);
+}
+
+// Half-width of the 95% confidence interval of the mean (Student's t, normal beyond 30 samples)
+double confidence95(const std::vector<double>& samples) {
+    static const double t_critical[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                          2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                          2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    const size_t n = samples.size();
+    if (n < 2) return 0.0;
+    const double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+    double squares = 0.0;
+    for (double sample : samples) squares += (sample - mean) * (sample - mean);
+    const double deviation = std::sqrt(squares / (n - 1));
+    return (n - 1 <= 30 ? t_critical[n - 2] : 1.96) * deviation / std::sqrt(static_cast<double>(n));
+}
+
+// Warm-up and measured sorts of one dataset with a warm p-worker sorter, then the same for
+// each baseline (the parallel ones run on the sorter's pool). Every sort starts from a fresh
+// copy of the input, and the last sort of each sorter is validated
+template <typename Key>
+BenchResult bench_config(const Config& config, const Dataset<Key>& dataset, int workers, const std::string& scaling) {
+    Config run_config = config;
+    run_config.num_workers = workers;
+    hss::Sorter<Key> sorter(make_options(run_config), dataset.less());
+    hss::Buffer<Key> keys = dataset.keys;
+    const hss::Fingerprint input_fingerprint = sorter.fingerprint(keys.data(), keys.size());
+    BenchResult result = {config.key_type, config.distribution, scaling, workers, keys.size(), 0, 0, 0, 0, true,
+                          0, 0, 0, 0};
+    // Sort times of sort_fn over the measured runs; clears result.valid if the output is wrong
+    auto measure = [&](auto&& sort_fn) {
+        std::vector<double> times;
+        for (int run = 0; run < config.bench_warmup + config.bench_reps; ++run) {
+            std::copy(dataset.keys.begin(), dataset.keys.end(), keys.begin());
+            auto start_sort = Clock::now();
+            sort_fn();
+            const double time = Duration(Clock::now() - start_sort).count();
+            if (run >= config.bench_warmup) times.push_back(time);
+        }
+        result.valid = result.valid && sorter.is_sorted(keys.data(), keys.size()) &&
+                       sorter.fingerprint(keys.data(), keys.size()) == input_fingerprint;
+        return times;
+    };
+    auto median = [](std::vector<double> times) {
+        std::sort(times.begin(), times.end());
+        return percentile(times, 0.5);
+    };
+
+    std::vector<double> times = measure([&] { sorter.sort(keys.data(), keys.size()); });
+    if (config.baselines) {
+        const KeyLess<Key> less = dataset.less();
+        result.std_sort = median(measure([&] { std::sort(keys.begin(), keys.end(), less); }));
+#ifdef HSS_PAR_UNSEQ
+        result.par_unseq = median(measure([&] { std::sort(std::execution::par_unseq, keys.begin(), keys.end(), less); }));
+#endif
+        std::vector<Key> merge_buffer;
+        result.merge_sort = median(measure([&] { parallel_merge_sort(sorter, keys.data(), keys.size(), merge_buffer); }));
+        SampleSortBuffers<Key> sample_buffers;
+        result.sample_sort = median(measure([&] {
+            sample_sort(sorter, keys.data(), keys.size(), sample_buffers, config.random_seed);
+        }));
+    }
+    result.ci95 = confidence95(times);
+    std::sort(times.begin(), times.end());
+    result.median = percentile(times, 0.5);
+    result.p10 = percentile(times, 0.1);
+    result.p90 = percentile(times, 0.9);
+    std::cerr << "[bench] " << result.key_type << " " << result.distribution << " " << scaling << " p=" << workers
+              << " N=" << result.elements << ": " << result.median << " s\n";
+    return result;
+}
+
+// Sweep one key type: strong scaling at every size, then weak scaling with the largest size's
+// elements per worker at the most workers
+template <typename Key>
+void bench_type(Config config, std::vector<BenchResult>& results) {
+    const size_t per_worker = config.sweep_sizes.back() / config.sweep_workers.back();
+    for (const std::string& distribution : config.sweep_dists) {
+        config.distribution = distribution;
+        auto bench_size = [&](size_t elements, const std::vector<int>& workers, const std::string& scaling) {
+            config.total_elements = elements;
+            Dataset<Key> dataset;
+            dataset.keys = hss::Buffer<Key>(hss::BufferAllocator<Key>(config.huge_pages, config.populate));
+            generate_dataset(config, dataset);
+            for (int p : workers) results.push_back(bench_config(config, dataset, p, scaling));
+        };
+        for (size_t elements : config.sweep_sizes) {
+            bench_size(elements, config.sweep_workers, "strong");
+        }
+        for (int p : config.sweep_workers) {
+            bench_size(per_worker * p, {p}, "weak");
+        }
+    }
+}
+
+// Benchmark mode: sweep key types, distributions, sizes and worker counts, then print the
+// statistics and the strong- and weak-scaling efficiency relative to the fewest workers
+int run_bench(const Config& config) {
+    std::vector<BenchResult> results;
+    for (const std::string& key_type : config.sweep_types) {
+        Config type_config = config;
+        type_config.key_type = key_type;
+        if (key_type == "i64") bench_type<long long>(type_config, results);
+        else if (key_type == "i32") bench_type<int32_t>(type_config, results);
+        else if (key_type == "u64") bench_type<uint64_t>(type_config, results);
+        else if (key_type == "u32") bench_type<uint32_t>(type_config, results);
+        else if (key_type == "f64") bench_type<double>(type_config, results);
+        else if (key_type == "f32") bench_type<float>(type_config, results);
+        else if (key_type == "string") bench_type<StringRef>(type_config, results);
+        else {
+            std::cerr << "Unknown benchmark key type: " << key_type << "\n";
+            return 1;
+        }
+    }
+    const bool all_valid = std::all_of(results.begin(), results.end(), [](const BenchResult& r) { return r.valid; });
+
+    if (config.report == "csv") {
+        std::cout << std::setprecision(9);
+        std::cout << "key_type,distribution,scaling,workers,elements,warmup,reps,median_seconds,p10_seconds,"
+                     "p90_seconds,ci95_seconds,keys_per_second,valid,std_sort_seconds,par_unseq_seconds,"
+                     "merge_sort_seconds,sample_sort_seconds\n";
+        for (const BenchResult& r : results) {
+            std::cout << r.key_type << "," << r.distribution << "," << r.scaling << "," << r.workers << ","
+                      << r.elements << "," << config.bench_warmup << "," << config.bench_reps << "," << r.median << ","
+                      << r.p10 << "," << r.p90 << "," << r.ci95 << "," << r.elements / r.median << "," << r.valid << ","
+                      << r.std_sort << "," << r.par_unseq << "," << r.merge_sort << "," << r.sample_sort << "\n";
+        }
+        return all_valid ? 0 : 1;
+    }
+    if (config.report == "json") {
+        std::cout << std::setprecision(9) << "{\"warmup\": " << config.bench_warmup << ", \"reps\": " << config.bench_reps
+                  << ", \"seed\": " << config.random_seed << ", \"cpu_model\": " << quoted(cpu_model())
+                  << ", \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            std::cout << "  {\"key_type\": " << quoted(r.key_type) << ", \"distribution\": " << quoted(r.distribution)
+                      << ", \"scaling\": " << quoted(r.scaling) << ", \"workers\": " << r.workers
+                      << ", \"elements\": " << r.elements << ", \"median_seconds\": " << r.median
+                      << ", \"p10_seconds\": " << r.p10 << ", \"p90_seconds\": " << r.p90
+                      << ", \"ci95_seconds\": " << r.ci95 << ", \"keys_per_second\": " << r.elements / r.median
+                      << ", \"valid\": " << (r.valid ? "true" : "false") << ", \"std_sort_seconds\": " << r.std_sort
+                      << ", \"par_unseq_seconds\": " << r.par_unseq << ", \"merge_sort_seconds\": " << r.merge_sort
+                      << ", \"sample_sort_seconds\": " << r.sample_sort << "}"
+                      << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        std::cout << "]}\n";
+        return all_valid ? 0 : 1;
+    }
+
+    std::cout << "Validation: " << (all_valid ? "Sorted correctly!" : "Sorting failed!") << "\n";
+    std::cout << "\nBenchmark: " << config.bench_warmup << " warm-up + " << config.bench_reps
+              << " measured sorts per configuration (seed " << config.random_seed << ", " << cpu_model() << ")\n";
+    std::cout << std::left << std::setw(8) << "Type" << std::setw(9) << "Dist" << std::setw(8) << "Scaling"
+              << std::right << std::setw(8) << "Workers" << std::setw(12) << "Elements" << std::setw(12) << "Median (s)"
+              << std::setw(11) << "p10 (s)" << std::setw(11) << "p90 (s)" << std::setw(13) << "95% CI (s)"
+              << std::setw(10) << "Mkeys/s" << "\n";
+    std::cout << std::fixed << std::setprecision(4);
+    for (const BenchResult& r : results) {
+        std::cout << std::left << std::setw(8) << r.key_type << std::setw(9) << r.distribution << std::setw(8)
+                  << r.scaling << std::right << std::setw(8) << r.workers << std::setw(12) << r.elements
+                  << std::setw(12) << r.median << std::setw(11) << r.p10 << std::setw(11) << r.p90
+                  << std::setw(7) << "+/-" << std::setw(6) << r.ci95 << std::setw(10) << std::setprecision(2)
+                  << r.elements / r.median / 1e6 << std::setprecision(4) << (r.valid ? "" : "  INVALID") << "\n";
+    }
+
+    // Baseline median over HSS median on the same input: above 1 means HSS is faster
+    if (config.baselines) {
+        std::cout << "\nSpeedup of HSS over Baselines (baseline median / HSS median):\n";
+        std::cout << std::left << std::setw(8) << "Type" << std::setw(9) << "Dist" << std::setw(8) << "Scaling"
+                  << std::right << std::setw(8) << "Workers" << std::setw(12) << "Elements" << std::setw(11) << "std::sort"
+                  << std::setw(11) << "par_unseq" << std::setw(12) << "merge sort" << std::setw(13) << "sample sort" << "\n";
+        std::cout << std::setprecision(2);
+        for (const BenchResult& r : results) {
+            std::cout << std::left << std::setw(8) << r.key_type << std::setw(9) << r.distribution << std::setw(8)
+                      << r.scaling << std::right << std::setw(8) << r.workers << std::setw(12) << r.elements
+                      << std::setw(10) << r.std_sort / r.median << "x";
+            if (r.par_unseq > 0) {
+                std::cout << std::setw(10) << r.par_unseq / r.median << "x";
+            } else {
+                std::cout << std::setw(11) << "n/a";
+            }
+            std::cout << std::setw(11) << r.merge_sort / r.median << "x" << std::setw(12) << r.sample_sort / r.median
+                      << "x\n";
+        }
+        std::cout << std::setprecision(4);
+#ifndef HSS_PAR_UNSEQ
+        std::cout << "par_unseq: n/a (built without a parallel algorithms backend, see Makefile)\n";
+#endif
+    }
+
+    // Efficiency against the first (fewest-worker) run of each series: strong scaling divides
+    // the speedup by the added workers, weak scaling compares times directly
+    std::cout << "\nScaling Efficiency (relative to " << config.sweep_workers.front() << " workers):\n";
+    for (size_t first = 0; first < results.size();) {
+        size_t last = first + 1;
+        const BenchResult& base = results[first];
+        while (last < results.size() && results[last].key_type == base.key_type &&
+               results[last].distribution == base.distribution && results[last].scaling == base.scaling &&
+               (base.scaling == "weak" || results[last].elements == base.elements)) {
+            last++;
+        }
+        std::cout << base.key_type << " " << base.distribution << " " << base.scaling;
+        if (base.scaling == "strong") {
+            std::cout << " (N=" << base.elements << "):";
+        } else {
+            std::cout << " (N/p=" << base.elements / base.workers << "):";
+        }
+        for (size_t i = first; i < last; ++i) {
+            const BenchResult& r = results[i];
+            const double efficiency = r.scaling == "strong"
+                                    ? base.median * base.workers / (r.median * r.workers)
+                                    : base.median / r.median;
+            std::cout << " p=" << r.workers << " " << std::setprecision(0) << efficiency * 100 << "%"
+                      << std::setprecision(4);
+        }
+        std::cout << "\n";
+        first = last;
+    }
+    return all_valid ? 0 : 1;
+}
+
+// Comma-separated list of a command-line option
+std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+// Composite record for the comparator/projection demo (--type=record)
+struct Order {
+    int32_t region;
+    int32_t priority;
+    uint64_t order_id;
+    double amount;
+};
+
+// Sort orders by (region, priority descending, order id) through hss::sort with a projection.
+// With --stable the order id is left out of the key: orders are generated in id order, so a
+// stable sort must still return equal (region, priority) groups in id order
+int run_records(const Config& config) {
+    const size_t n = config.total_elements;
+    std::vector<Order> orders(n);
+    std::mt19937 rng(config.random_seed);
+    std::uniform_real_distribution<double> amount(0.0, 1000.0);
+    for (size_t i = 0; i < n; ++i) {
+        orders[i] = {static_cast<int32_t>(rng() % 16), static_cast<int32_t>(rng() % 5), i, amount(rng)};
+    }
+    std::vector<Order> reference = orders;
+
+    // Multiple fields without materialising a key column: the projection builds a tuple
+    const uint64_t id_weight = config.stable ? 0 : 1;
+    auto by_region_priority = [id_weight](const Order& order) {
+        return std::make_tuple(order.region, -order.priority, order.order_id * id_weight);
+    };
+    const hss::Options options = make_options(config);
+
+    auto start_hss = Clock::now();
+    hss::sort(orders.begin(), orders.end(), std::less<>(), by_region_priority, options);
+    double hss_time = Duration(Clock::now() - start_hss).count();
+
+    auto start_std = Clock::now();
+    auto reference_less = [&](const Order& a, const Order& b) {
+        return by_region_priority(a) < by_region_priority(b);
+    };
+    if (config.stable) {
+        std::stable_sort(reference.begin(), reference.end(), reference_less);
+    } else {
+        std::sort(reference.begin(), reference.end(), reference_less);
+    }
+    double std_time = Duration(Clock::now() - start_std).count();
+
+    // Order ids are unique (or input order decides ties), so both results must match exactly
+    const bool is_valid = std::equal(orders.begin(), orders.end(), reference.begin(), reference.end(),
+                                     [](const Order& a, const Order& b) { return a.order_id == b.order_id; });
+    std::cout << "Validation: " 
+              << (is_valid ? "Sorted correctly!" : "Sorting failed!") 
+              << "\n";
+    std::cout << "\nRecord Sorting (" << n << " orders by region, priority descending"
+              << (config.stable ? ", stable" : ", order id") << "):\n";
+    std::cout << "hss::sort: " << hss_time << " seconds\n";
+    std::cout << (config.stable ? "std::stable_sort" : "std::sort") << " (serial reference): "
+              << std_time << " seconds\n";
+    return is_valid ? 0 : 1;
+}
+
+// Main execution flow with total timing and initialization timers
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] 
+                  << " <seed> <workers> <imbalance> <size> [--verbose] [--stable] [--stream] [--dist=squares|uniform|zipf] [--repeat=<count>]"
+                  << " [--oversampling=<samples per bucket>] [--rounds=<max splitter rounds>]"
+                  << " [--huge-pages=off|thp|hugetlb] [--populate] [--in-place] [--processes] [--distributed[=local|mpi] [--levels=<n>] [--compress]] [--range=<lo>:<hi>] [--topk=<k>] [--report=json|csv] [--trace=<file>]"
+                  << " [--bench [--reps=<n>] [--warmup=<n>] [--sweep-workers=<list>] [--sweep-sizes=<list>]"
+                  << " [--sweep-types=<list>] [--sweep-dists=<list>] [--no-baselines]]"
+                  << " [--type=i64|i32|u64|u32|f64|f32|string|record] [--payload=8|16|32|64]"
+                  << " [--payload-strategy=move|permute|both]"
+                  << " [--cpus=0,1,...]\n";
+        return 1;
+    }
+
+    // Parse command-line arguments
+    Config config;
+    config.random_seed = std::stoi(argv[1]);
+    config.num_workers = std::stoi(argv[2]);
+    config.max_imbalance = std::stod(argv[3]);
+    config.total_elements = std::stoul(argv[4]);
+    config.oversampling = 0;
+    config.splitter_rounds = 1;
+    config.verbose_output = false;
+    config.streaming = false;
+    config.stable = false;
+    config.distribution = "squares";
+    config.repeat = 1;
+    config.huge_pages = hss::HugePages::Off;
+    config.populate = false;
+    config.in_place = false;
+    config.processes = false;
+    config.distributed = "";
+    config.levels = 1;
+    config.compress = false;
+    config.partial = false;
+    config.range_begin = 0;
+    config.range_end = config.total_elements;
+    config.report = "";
+    config.trace_file = "";
+    config.bench = false;
+    config.bench_reps = 5;
+    config.bench_warmup = 1;
+    config.sweep_dists = {"squares", "uniform", "zipf"};
+    config.sweep_types = {"i64", "string"};
+    config.baselines = true;
+    config.key_type = "i64";
+    size_t payload_bytes = 0;
+    int payload_strategies = PAYLOAD_MOVE | PAYLOAD_PERMUTE;
+    bool type_given = false;            // --type=, the single benchmark type unless --sweep-types= is given
+    bool sweep_types_given = false;
+    for (int i = 5; i < argc; ++i) {
+        const std::string option = argv[i];
+        if (option == "--verbose") {
+            config.verbose_output = true;
+        } else if (option == "--stable") {
+            config.stable = true;
+        } else if (option == "--stream") {
+            config.streaming = true;
+        } else if (option.rfind("--report=", 0) == 0) {
+            config.report = option.substr(9);
+            if (config.report != "json" && config.report != "csv") {
+                std::cerr << "Unknown report format: " << config.report << " (expected json or csv)\n";
+                return 1;
+            }
+        } else if (option.rfind("--trace=", 0) == 0) {
+            config.trace_file = option.substr(8);
+            if (!hss::TRACE_SUPPORTED) {
+                std::cerr << "--trace needs a build with -DHSS_TRACE (make trace)\n";
+                return 1;
+            }
+        } else if (option == "--bench") {
+            config.bench = true;
+        } else if (option == "--no-baselines") {
+            config.baselines = false;
+        } else if (option.rfind("--reps=", 0) == 0) {
+            config.bench_reps = std::max(1, std::stoi(option.substr(7)));
+        } else if (option.rfind("--warmup=", 0) == 0) {
+            config.bench_warmup = std::max(0, std::stoi(option.substr(9)));
+        } else if (option.rfind("--sweep-workers=", 0) == 0) {
+            config.sweep_workers.clear();
+            for (const std::string& item : split_list(option.substr(16))) {
+                config.sweep_workers.push_back(std::max(1, std::stoi(item)));
+            }
+        } else if (option.rfind("--sweep-sizes=", 0) == 0) {
+            config.sweep_sizes.clear();
+            for (const std::string& item : split_list(option.substr(14))) {
+                config.sweep_sizes.push_back(std::stoul(item));
+            }
+        } else if (option.rfind("--sweep-types=", 0) == 0) {
+            config.sweep_types = split_list(option.substr(14));
+            sweep_types_given = true;
+        } else if (option.rfind("--sweep-dists=", 0) == 0) {
+            config.sweep_dists = split_list(option.substr(14));
+        } else if (option == "--in-place") {
+            config.in_place = true;
+        } else if (option == "--processes") {
+            config.processes = true;
+        } else if (option == "--distributed" || option.rfind("--distributed=", 0) == 0) {
+            config.distributed = option == "--distributed" ? "local" : option.substr(14);
+            if (config.distributed != "local" && config.distributed != "mpi") {
+                std::cerr << "Unknown transport: " << config.distributed << " (expected local or mpi)\n";
+                return 1;
+            }
+#ifndef HSS_MPI
+            if (config.distributed == "mpi") {
+                std::cerr << "--distributed=mpi needs a build with MPI (make MPI=1)\n";
+                return 1;
+            }
+#endif
+        } else if (option == "--populate") {
+            config.populate = true;
+        } else if (option.rfind("--huge-pages=", 0) == 0) {
+            const std::string mode = option.substr(13);
+            if (mode == "off") {
+                config.huge_pages = hss::HugePages::Off;
+            } else if (mode == "thp") {
+                config.huge_pages = hss::HugePages::Transparent;
+            } else if (mode == "hugetlb") {
+                config.huge_pages = hss::HugePages::Explicit;
+            } else {
+                std::cerr << "Unknown huge page mode: " << mode << " (expected off, thp or hugetlb)\n";
+                return 1;
+            }
+        } else if (option.rfind("--oversampling=", 0) == 0) {
+            config.oversampling = std::stoul(option.substr(15));
+        } else if (option.rfind("--rounds=", 0) == 0) {
+            config.splitter_rounds = std::max(1, std::stoi(option.substr(9)));
+        } else if (option.rfind("--range=", 0) == 0) {
+            const std::string range = option.substr(8);
+            const size_t colon = range.find(':');
+            if (colon == std::string::npos) {
+                std::cerr << "Expected --range=<lo>:<hi>\n";
+                return 1;
+            }
+            config.partial = true;
+            config.range_begin = std::stoul(range.substr(0, colon));
+            config.range_end = std::stoul(range.substr(colon + 1));
+            if (config.range_begin > config.range_end || config.range_end > config.total_elements) {
+                std::cerr << "--range needs lo <= hi <= size\n";
+                return 1;
+            }
+        } else if (option.rfind("--topk=", 0) == 0) {
+            const size_t k = std::min<size_t>(std::stoul(option.substr(7)), config.total_elements);
+            config.partial = true;
+            config.range_begin = config.total_elements - k;
+            config.range_end = config.total_elements;
+        } else if (option == "--compress") {
+            config.compress = true;
+        } else if (option.rfind("--levels=", 0) == 0) {
+            config.levels = std::max(1, std::stoi(option.substr(9)));
+        } else if (option.rfind("--repeat=", 0) == 0) {
+            config.repeat = std::max(1, std::stoi(option.substr(9)));
+        } else if (option.rfind("--dist=", 0) == 0) {
+            config.distribution = option.substr(7);
+            if (config.distribution != "squares" && config.distribution != "uniform" &&
+                config.distribution != "zipf") {
+                std::cerr << "Unknown distribution: " << config.distribution
+                          << " (expected squares, uniform or zipf)\n";
+                return 1;
+            }
+        } else if (option.rfind("--type=", 0) == 0) {
+            config.key_type = option.substr(7);
+            type_given = true;
+        } else if (option.rfind("--payload=", 0) == 0) {
+            payload_bytes = std::stoul(option.substr(10));
+        } else if (option.rfind("--payload-strategy=", 0) == 0) {
+            const std::string strategy = option.substr(19);
+            if (strategy == "move") {
+                payload_strategies = PAYLOAD_MOVE;
+            } else if (strategy == "permute") {
+                payload_strategies = PAYLOAD_PERMUTE;
+            } else if (strategy == "both") {
+                payload_strategies = PAYLOAD_MOVE | PAYLOAD_PERMUTE;
+            } else {
+                std::cerr << "Unknown payload strategy: " << strategy << "\n";
+                return 1;
+            }
+        } else if (option.rfind("--cpus=", 0) == 0) {
+            std::stringstream cpus(option.substr(7));
+            std::string cpu;
+            while (std::getline(cpus, cpu, ',')) {
+                config.cpu_affinity.push_back(std::stoi(cpu));
+            }
+        } else {
+            std::cerr << "Unknown option: " << option << "\n";
+            return 1;
+        }
+    }
+
+    // Runs from different batches are merged without regard to arrival order
+    if (config.stable && config.streaming) {
+        std::cerr << "--stable is not available with --stream\n";
+        return 1;
+    }
+    // The stable merge reads every worker's sorted chunk, so it needs the chunk copies
+    if (config.stable && config.in_place) {
+        std::cerr << "--in-place is not available with --stable\n";
+        return 1;
+    }
+    // Checked before any mode is dispatched, so that no mode ignores them
+    if ((config.levels > 1 || config.compress) && config.distributed.empty()) {
+        std::cerr << "--levels and --compress apply to --distributed\n";
+        return 1;
+    }
+    if (config.compress && config.key_type == "string") {
+        std::cerr << "--compress supports i64, i32, u64, u32, f64 and f32 keys\n";
+        return 1;
+    }
+
+    // Benchmark sweep: powers of two up to <workers> and the single <size> unless overridden
+    if (config.bench) {
+        if (config.streaming || payload_bytes > 0 || config.processes || !config.distributed.empty() ||
+            config.partial) {
+            std::cerr << "--bench is not available with --stream, --payload, --processes, --distributed, --range"
+                         " or --topk\n";
+            return 1;
+        }
+        if (type_given) {
+            if (sweep_types_given) {
+                std::cerr << "--bench takes either --type or --sweep-types\n";
+                return 1;
+            }
+            config.sweep_types = {config.key_type};
+        }
+        if (config.sweep_workers.empty()) {
+            for (int p = 1; p < config.num_workers; p *= 2) config.sweep_workers.push_back(p);
+            config.sweep_workers.push_back(config.num_workers);
+        }
+        if (config.sweep_sizes.empty()) config.sweep_sizes.push_back(config.total_elements);
+        for (const std::string& distribution : config.sweep_dists) {
+            if (distribution != "squares" && distribution != "uniform" && distribution != "zipf") {
+                std::cerr << "Unknown distribution: " << distribution << " (expected squares, uniform or zipf)\n";
+                return 1;
+            }
+        }
+        std::sort(config.sweep_workers.begin(), config.sweep_workers.end());
+        std::sort(config.sweep_sizes.begin(), config.sweep_sizes.end());
+        return run_bench(config);
+    }
+
+    // The structured report describes one HSS run over generated keys
+    if (!config.report.empty() && (config.streaming || payload_bytes > 0 || config.key_type == "record")) {
+        std::cerr << "--report is not available with --stream, --payload or --type=record\n";
+        return 1;
+    }
+    if (!config.trace_file.empty() && (config.streaming || payload_bytes > 0 || config.key_type == "record")) {
+        std::cerr << "--trace is not available with --stream, --payload or --type=record\n";
+        return 1;
+    }
+
+    // Process mode runs one unstable round on trivially copyable keys
+    if (config.processes) {
+        if (config.stable || config.in_place || config.streaming || payload_bytes > 0 || !config.distributed.empty() ||
+            config.partial || !config.report.empty() || !config.trace_file.empty()) {
+            std::cerr << "--processes is not available with --stable, --in-place, --stream, --payload, --distributed,"
+                         " --range, --topk, --report or --trace\n";
+            return 1;
+        }
+        if (config.key_type == "i64") return run_processes<long long>(config);
+        if (config.key_type == "i32") return run_processes<int32_t>(config);
+        if (config.key_type == "u64") return run_processes<uint64_t>(config);
+        if (config.key_type == "u32") return run_processes<uint32_t>(config);
+        if (config.key_type == "f64") return run_processes<double>(config);
+        if (config.key_type == "f32") return run_processes<float>(config);
+        if (config.key_type == "string") return run_processes<StringRef>(config);
+        std::cerr << "--processes supports i64, i32, u64, u32, f64, f32 and string keys\n";
+        return 1;
+    }
+
+    // Distributed mode runs one unstable sort per rank on trivially copyable keys
+    if (!config.distributed.empty()) {
+        if (config.stable || config.in_place || config.streaming || payload_bytes > 0 || config.partial ||
+            !config.report.empty() || !config.trace_file.empty()) {
+            std::cerr << "--distributed is not available with --stable, --in-place, --stream, --payload, --range,"
+                         " --topk, --report or --trace\n";
+            return 1;
+        }
+        if (config.key_type == "i64") return run_distributed<long long>(config);
+        if (config.key_type == "i32") return run_distributed<int32_t>(config);
+        if (config.key_type == "u64") return run_distributed<uint64_t>(config);
+        if (config.key_type == "u32") return run_distributed<uint32_t>(config);
+        if (config.key_type == "f64") return run_distributed<double>(config);
+        if (config.key_type == "f32") return run_distributed<float>(config);
+        if (config.key_type == "string") return run_distributed<StringRef>(config);
+        std::cerr << "--distributed supports i64, i32, u64, u32, f64, f32 and string keys\n";
+        return 1;
+    }
+
+    // Partial sorts run on the thread pool and compare with a full sort
+    if (config.partial) {
+        if (config.streaming || payload_bytes > 0 || !config.report.empty() || !config.trace_file.empty()) {
+            std::cerr << "--range and --topk are not available with --stream, --payload, --report or --trace\n";
+            return 1;
+        }
+        if (config.key_type == "i64") return run_partial<long long>(config);
+        if (config.key_type == "i32") return run_partial<int32_t>(config);
+        if (config.key_type == "u64") return run_partial<uint64_t>(config);
+        if (config.key_type == "u32") return run_partial<uint32_t>(config);
+        if (config.key_type == "f64") return run_partial<double>(config);
+        if (config.key_type == "f32") return run_partial<float>(config);
+        if (config.key_type == "string") return run_partial<StringRef>(config);
+        std::cerr << "--range and --topk support i64, i32, u64, u32, f64, f32 and string keys\n";
+        return 1;
+    }
+
+    // Key-value mode carries a fixed-size payload with 64-bit keys
+    if (payload_bytes > 0) {
+        if (config.key_type != "i64" || config.streaming) {
+            std::cerr << "--payload requires --type=i64 and is not available with --stream\n";
+            return 1;
+        }
+        switch (payload_bytes) {
+            case 8: return run_payload<8>(config, payload_strategies);
+            case 16: return run_payload<16>(config, payload_strategies);
+            case 32: return run_payload<32>(config, payload_strategies);
+            case 64: return run_payload<64>(config, payload_strategies);
+        }
+        std::cerr << "Unsupported payload size: " << payload_bytes << " (expected 8, 16, 32 or 64)\n";
+        return 1;
+    }
+
+    // Instantiate the pipeline for the requested key type
+    if (config.key_type == "i64") return run_typed<long long>(config);
+    if (config.key_type == "i32") return run_typed<int32_t>(config);
+    if (config.key_type == "u64") return run_typed<uint64_t>(config);
+    if (config.key_type == "u32") return run_typed<uint32_t>(config);
+    if (config.key_type == "f64") return run_typed<double>(config);
+    if (config.key_type == "f32") return run_typed<float>(config);
+    if (config.key_type == "string") return run_typed<StringRef>(config);
+    if (config.key_type == "record" && !config.streaming) return run_records(config);
+    std::cerr << "Unknown key type: " << config.key_type
+              << " (expected i64, i32, u64, u32, f64, f32, string or record)\n";
+    return 1;
+}
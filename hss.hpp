@@ -0,0 +1,3502 @@
+// Histogram-based Sample Sort (HSS) as a header-only library.
+//
+// hss::Sorter owns its configuration, barriers, buffers and worker thread pool, so several
+// sorters can run independently in one process. hss::sort() is a one-shot convenience
+// wrapper, hss::StreamSorter sorts an unbounded sequence of batches into leveled runs, and
+// hss::ProcessSorter runs the workers as forked processes on a shared-memory segment, and
+// hss::DistributedSorter runs one rank per process over a Transport (local sockets or MPI).
+#ifndef HSS_HPP
+#define HSS_HPP
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#include <string>
+#include <chrono>
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#ifdef HSS_MPI
+#include <mpi.h>
+#endif
+
+namespace hss {
+
+// Using directives for cleaner timing code
+using Clock = std::chrono::high_resolution_clock;
+using Duration = std::chrono::duration<double>;
+
+// Local sort backends a key type can select through its traits
+enum class SortBackend {
+    Comparison,                         // std::sort with the key comparator
+    Radix,                              // LSD radix sort over KeyTraits::to_bits
+    MultikeyQuicksort                   // Three-way string quicksort on one character at a time
+};
+
+// Total-order key traits: to_bits() maps a key to an unsigned integer whose natural
+// order is the sort order; it drives both the radix backend and float comparisons
+template <typename Key, typename Enable = void>
+struct KeyTraits;
+
+template <typename Key>
+struct KeyTraits<Key, std::enable_if_t<std::is_integral_v<Key>>> {
+    using Bits = std::make_unsigned_t<Key>;
+    static constexpr SortBackend backend = SortBackend::Radix;
+    static Bits to_bits(Key key) {
+        if constexpr (std::is_signed_v<Key>) {
+            // Flip the sign bit so negative values order before positive ones
+            return static_cast<Bits>(key) ^ (Bits(1) << (sizeof(Key) * 8 - 1));
+        } else {
+            return key;
+        }
+    }
+    static Key from_bits(Bits bits) {
+        if constexpr (std::is_signed_v<Key>) {
+            return static_cast<Key>(bits ^ (Bits(1) << (sizeof(Key) * 8 - 1)));
+        } else {
+            return bits;
+        }
+    }
+    static bool less(Key a, Key b) { return a < b; }
+};
+
+template <typename Key>
+struct KeyTraits<Key, std::enable_if_t<std::is_same_v<Key, float> || std::is_same_v<Key, double>>> {
+    using Bits = std::conditional_t<sizeof(Key) == 4, uint32_t, uint64_t>;
+    static constexpr SortBackend backend = SortBackend::Radix;
+    // IEEE-754 total order: negative values have all bits inverted and positive values get
+    // the sign bit set, giving -NaN < -inf < ... < -0.0 < +0.0 < ... < +inf < +NaN
+    static Bits to_bits(Key key) {
+        Bits bits;
+        std::memcpy(&bits, &key, sizeof(Key));
+        const Bits sign = Bits(1) << (sizeof(Key) * 8 - 1);
+        return (bits & sign) ? ~bits : (bits | sign);
+    }
+    static Key from_bits(Bits bits) {
+        const Bits sign = Bits(1) << (sizeof(Key) * 8 - 1);
+        bits = (bits & sign) ? (bits & ~sign) : ~bits;
+        Key key;
+        std::memcpy(&key, &bits, sizeof(Key));
+        return key;
+    }
+    static bool less(Key a, Key b) { return to_bits(a) < to_bits(b); }
+};
+
+// Record carrying a payload alongside a 64-bit key; ordered by key only
+template <typename Payload>
+struct KeyValue {
+    long long key;
+    Payload value;
+};
+
+template <typename Payload>
+struct KeyTraits<KeyValue<Payload>> {
+    using Bits = KeyTraits<long long>::Bits;
+    static constexpr SortBackend backend = SortBackend::Radix;
+    static Bits to_bits(const KeyValue<Payload>& record) { return KeyTraits<long long>::to_bits(record.key); }
+    static bool less(const KeyValue<Payload>& a, const KeyValue<Payload>& b) { return a.key < b.key; }
+};
+
+template <typename Payload>
+std::ostream& operator<<(std::ostream& os, const KeyValue<Payload>& record) {
+    return os << record.key;
+}
+
+// String key whose bytes live in a caller-owned arena; the first 8 bytes are cached big-endian
+// and zero padded, so most comparisons are decided by one integer compare on the prefix
+struct StringRef {
+    uint64_t prefix;                    // First 8 bytes, big-endian, zero padded
+    uint32_t offset;                    // Start of the string in the arena
+    uint32_t length;                    // Length in bytes
+};
+
+template <>
+struct KeyTraits<StringRef> {
+    static constexpr SortBackend backend = SortBackend::MultikeyQuicksort;
+};
+
+// Cached prefix of a string: its first 8 bytes as a big-endian integer
+inline uint64_t string_prefix(const char* bytes, size_t length) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        prefix = (prefix << 8) | (i < length ? static_cast<unsigned char>(bytes[i]) : 0);
+    }
+    return prefix;
+}
+
+// Comparator used for every key comparison in the pipeline
+template <typename Key>
+struct KeyLess {
+    bool operator()(const Key& a, const Key& b) const { return KeyTraits<Key>::less(a, b); }
+};
+
+// String comparator: prefix first, arena bytes only when the prefixes tie
+template <>
+struct KeyLess<StringRef> {
+    const char* arena = nullptr;
+
+    bool operator()(const StringRef& a, const StringRef& b) const {
+        if (a.prefix != b.prefix) return a.prefix < b.prefix;
+        const uint32_t common = std::min(a.length, b.length);
+        if (common > 8) {
+            const int cmp = std::memcmp(arena + a.offset + 8, arena + b.offset + 8, common - 8);
+            if (cmp != 0) return cmp < 0;
+        }
+        return a.length < b.length;
+    }
+};
+
+// Projection that returns its argument unchanged (std::identity in C++20)
+struct Identity {
+    template <typename T>
+    constexpr T&& operator()(T&& value) const noexcept { return std::forward<T>(value); }
+};
+
+// Orders elements by comp(proj(a), proj(b)); comp and proj are called directly and inlined
+template <typename Comp, typename Proj>
+struct ProjectedLess {
+    Comp comp;
+    Proj proj;
+
+    template <typename T>
+    bool operator()(const T& a, const T& b) const {
+        return std::invoke(comp, std::invoke(proj, a), std::invoke(proj, b));
+    }
+};
+
+// Detects element types that can be written to a stream
+template <typename T, typename = void>
+struct is_printable : std::false_type {};
+template <typename T>
+struct is_printable<T, std::void_t<decltype(std::declval<std::ostream&>() << std::declval<const T&>())>>
+    : std::true_type {};
+
+// Write one key for debug output; string keys are read from the arena held by their comparator
+template <typename Key, typename Less>
+void print_key(std::ostream& os, const Key& key, const Less&) {
+    if constexpr (is_printable<Key>::value) os << key;
+}
+
+inline void print_key(std::ostream& os, const StringRef& key, const KeyLess<StringRef>& less) {
+    os.write(less.arena + key.offset, key.length);
+}
+
+// Print vector contents (limited to first 10 elements for brevity)
+template <typename Key, typename Alloc, typename Less>
+void print_vector(const std::string& label, const std::vector<Key, Alloc>& vec, const Less& less) {
+    std::cerr << "[DEBUG] " << label << " (" << vec.size() << " elements)";
+    if constexpr (is_printable<Key>::value || std::is_same_v<Key, StringRef>) {
+        std::cerr << ": [";
+        for (size_t i = 0; i < std::min(vec.size(), 10UL); ++i) {
+            print_key(std::cerr, vec[i], less);
+            std::cerr << (i < vec.size()-1 ? ", " : "");
+        }
+        if (vec.size() > 10) std::cerr << "...";
+        std::cerr << "]";
+    }
+    std::cerr << "\n";
+}
+
+// Inputs smaller than this are sorted with std::sort even when a radix backend exists
+constexpr size_t RADIX_SORT_THRESHOLD = 2048;
+
+// LSD radix sort on the total-order bits, one byte per pass; passes where every key
+// shares the same digit are skipped, so narrow value ranges cost fewer passes. Sorts
+// keys[0, n) ping-ponging with scratch and returns whichever of the two holds the result
+template <typename Key>
+Key* radix_sort(Key* keys, size_t n, Key* scratch) {
+    using Traits = KeyTraits<Key>;
+    constexpr int passes = sizeof(typename Traits::Bits);
+
+    // Build the histograms of all digits in a single read pass
+    std::array<std::array<size_t, 256>, passes> counts{};
+    for (size_t i = 0; i < n; ++i) {
+        const auto bits = Traits::to_bits(keys[i]);
+        for (int pass = 0; pass < passes; ++pass) {
+            counts[pass][(bits >> (pass * 8)) & 0xFF]++;
+        }
+    }
+
+    Key* src = keys;
+    Key* dst = scratch;
+    for (int pass = 0; pass < passes; ++pass) {
+        auto& count = counts[pass];
+        if (count[(Traits::to_bits(src[0]) >> (pass * 8)) & 0xFF] == n) continue;
+        std::array<size_t, 256> offsets;
+        size_t running = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            offsets[digit] = running;
+            running += count[digit];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            dst[offsets[(Traits::to_bits(src[i]) >> (pass * 8)) & 0xFF]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+    return src;
+}
+
+// Character of a string at the given depth, or -1 past its end; the first 8 come from the prefix
+inline int string_char(const StringRef& key, size_t depth, const char* arena) {
+    if (depth >= key.length) return -1;
+    if (depth < 8) return static_cast<int>((key.prefix >> (56 - 8 * depth)) & 0xFF);
+    return static_cast<unsigned char>(arena[key.offset + depth]);
+}
+
+// Below this size multikey quicksort hands over to a comparison sort
+constexpr size_t MULTIKEY_THRESHOLD = 32;
+
+// Bentley-Sedgewick multikey quicksort; all keys in [keys, keys + n) share their first depth bytes
+inline void multikey_quicksort(StringRef* keys, size_t n, size_t depth, const KeyLess<StringRef>& less) {
+    while (n > MULTIKEY_THRESHOLD) {
+        // Median-of-three pivot character
+        int a = string_char(keys[0], depth, less.arena);
+        int b = string_char(keys[n / 2], depth, less.arena);
+        int c = string_char(keys[n - 1], depth, less.arena);
+        const int pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+        // Three-way partition on the character at this depth
+        size_t lt = 0, i = 0, gt = n;
+        while (i < gt) {
+            const int ch = string_char(keys[i], depth, less.arena);
+            if (ch < pivot) {
+                std::swap(keys[lt++], keys[i++]);
+            } else if (ch > pivot) {
+                std::swap(keys[i], keys[--gt]);
+            } else {
+                i++;
+            }
+        }
+
+        multikey_quicksort(keys, lt, depth, less);
+        multikey_quicksort(keys + gt, n - gt, depth, less);
+        if (pivot < 0) return; // Equal part holds identical complete strings
+        keys += lt;
+        n = gt - lt;
+        depth++;
+    }
+    std::sort(keys, keys + n, less);
+}
+
+// Local sort backend, chosen at compile time from the key traits; custom comparators
+// always use std::sort, which inlines them. Stable sorts keep the LSD radix backend
+// (it is stable) and otherwise fall back to std::stable_sort. Sorts keys[0, n) in place;
+// scratch keeps its capacity between calls. Returns false if the radix result was left
+// in scratch (only when allow_swap is set, so the caller can swap the vectors instead)
+template <typename Key, typename Scratch, typename Less>
+bool local_sort(Key* keys, size_t n, Scratch& scratch, const Less& less, bool stable = false,
+                bool allow_swap = false) {
+    if constexpr (std::is_same_v<Less, KeyLess<Key>>) {
+        if constexpr (KeyTraits<Key>::backend == SortBackend::Radix) {
+            if (n >= RADIX_SORT_THRESHOLD) {
+                if (scratch.size() < n) scratch.resize(n);
+                const Key* sorted = radix_sort(keys, n, scratch.data());
+                if (sorted == keys) return true;
+                if (allow_swap) return false;
+                std::copy(sorted, sorted + n, keys);
+                return true;
+            }
+        } else if constexpr (KeyTraits<Key>::backend == SortBackend::MultikeyQuicksort) {
+            if (!stable) {
+                multikey_quicksort(keys, n, 0, less);
+                return true;
+            }
+        }
+    }
+    if (stable) {
+        std::stable_sort(keys, keys + n, less);
+    } else {
+        std::sort(keys, keys + n, less);
+    }
+    return true;
+}
+
+// Sort a whole vector; a radix result left in scratch is swapped in rather than copied
+template <typename Key, typename Alloc, typename Less>
+void local_sort(std::vector<Key, Alloc>& keys, std::vector<Key, Alloc>& scratch, const Less& less, bool stable = false) {
+    if constexpr (std::is_same_v<Less, KeyLess<Key>>) {
+        if constexpr (KeyTraits<Key>::backend == SortBackend::Radix) {
+            scratch.resize(keys.size()); // Equal sizes make the swap valid; capacity is kept
+        }
+    }
+    if (!local_sort(keys.data(), keys.size(), scratch, less, stable, true)) {
+        keys.swap(scratch);
+    }
+}
+
+// Local sort without a scratch buffer, for the in-place mode: multikey quicksort for string
+// keys and std::sort otherwise (the LSD radix sort needs an n-element scratch)
+template <typename Key, typename Less>
+void in_place_sort(Key* keys, size_t n, const Less& less) {
+    if constexpr (std::is_same_v<Less, KeyLess<Key>>) {
+        if constexpr (KeyTraits<Key>::backend == SortBackend::MultikeyQuicksort) {
+            multikey_quicksort(keys, n, 0, less);
+            return;
+        }
+    }
+    std::sort(keys, keys + n, less);
+}
+
+// Name of the local sort backend used for a key type (for reporting). In place, radix keys
+// fall back to std::sort (in_place_sort); stable sorts of other keys use std::stable_sort
+template <typename Key>
+const char* backend_name(bool in_place = false, bool stable = false) {
+    switch (KeyTraits<Key>::backend) {
+        case SortBackend::Radix: return in_place && !stable ? "std::sort" : "radix";
+        case SortBackend::MultikeyQuicksort: return stable ? "std::stable_sort" : "multikey quicksort";
+        default: return stable ? "std::stable_sort" : "std::sort";
+    }
+}
+
+// Backing of large buffers (input, local chunks, radix scratch)
+enum class HugePages {
+    Off,                                // Regular pages: the heap, or a plain mmap for populated buffers
+    Transparent,                        // 2 MiB-aligned mmap with madvise(MADV_HUGEPAGE)
+    Explicit                            // mmap with MAP_HUGETLB; falls back to Transparent if none are reserved
+};
+
+constexpr size_t HUGE_PAGE_BYTES = 2 << 20;
+constexpr size_t LARGE_BUFFER_BYTES = 1 << 20; // Smaller buffers always come from the heap
+
+// Write one byte per page so the whole buffer is faulted in
+inline void prefault_buffer(void* buffer, size_t bytes) {
+    static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    volatile char* bytes_ptr = static_cast<char*>(buffer);
+    for (size_t offset = 0; offset < bytes; offset += page) bytes_ptr[offset] = 0;
+}
+
+// Large buffers are mapped when they need huge pages or pre-faulting; the rest use the heap
+inline bool mapped_buffer(size_t bytes, HugePages huge_pages, bool populate) {
+    return bytes >= LARGE_BUFFER_BYTES && (huge_pages != HugePages::Off || populate);
+}
+
+// Allocate a buffer with the requested page size; populate pre-faults it, with MAP_POPULATE
+// where the mapping allows and by writing every page otherwise
+inline void* map_buffer(size_t bytes, HugePages huge_pages, bool populate) {
+    if (!mapped_buffer(bytes, huge_pages, populate)) {
+        void* buffer = ::operator new(bytes);
+        if (populate) prefault_buffer(buffer, bytes);
+        return buffer;
+    }
+    const int populate_flag = populate ? MAP_POPULATE : 0;
+    if (huge_pages == HugePages::Off) {
+        void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | populate_flag,
+                            -1, 0);
+        if (mapped == MAP_FAILED) throw std::bad_alloc();
+        return mapped;
+    }
+    const size_t length = (bytes + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+#ifdef MAP_HUGETLB
+    if (huge_pages == HugePages::Explicit) {
+        void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate_flag, -1, 0);
+        if (mapped != MAP_FAILED) return mapped;
+    }
+#endif
+    // Over-map by one huge page and trim, so the region is 2 MiB aligned for THP
+    void* mapped = mmap(nullptr, length + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) throw std::bad_alloc();
+    char* base = static_cast<char*>(mapped);
+    char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(base) + HUGE_PAGE_BYTES - 1) &
+                                            ~(uintptr_t)(HUGE_PAGE_BYTES - 1));
+    if (aligned > base) munmap(base, aligned - base);
+    munmap(aligned + length, base + HUGE_PAGE_BYTES - aligned);
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, length, MADV_HUGEPAGE);
+#endif
+    // MAP_POPULATE would fault the region in before MADV_HUGEPAGE applies, so populate after
+    // it; kernels before 5.14 lack MADV_POPULATE_WRITE and get the pages written instead
+    if (populate) {
+#ifdef MADV_POPULATE_WRITE
+        if (madvise(aligned, length, MADV_POPULATE_WRITE) == 0) return aligned;
+#endif
+        prefault_buffer(aligned, length);
+    }
+    return aligned;
+}
+
+inline void unmap_buffer(void* buffer, size_t bytes, HugePages huge_pages, bool populate) {
+    if (!mapped_buffer(bytes, huge_pages, populate)) {
+        ::operator delete(buffer);
+        return;
+    }
+    if (huge_pages == HugePages::Off) {
+        munmap(buffer, bytes);
+        return;
+    }
+    munmap(buffer, (bytes + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1));
+}
+
+// Allocator for the large sort buffers; copies carry the page policy
+template <typename T>
+struct BufferAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    HugePages huge_pages = HugePages::Off;
+    bool populate = false;
+
+    BufferAllocator() = default;
+    BufferAllocator(HugePages huge_pages, bool populate) : huge_pages(huge_pages), populate(populate) {}
+    template <typename U>
+    BufferAllocator(const BufferAllocator<U>& other) : huge_pages(other.huge_pages), populate(other.populate) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(map_buffer(n * sizeof(T), huge_pages, populate)); }
+    void deallocate(T* buffer, size_t n) { unmap_buffer(buffer, n * sizeof(T), huge_pages, populate); }
+
+    template <typename U>
+    bool operator==(const BufferAllocator<U>& other) const {
+        return huge_pages == other.huge_pages && populate == other.populate;
+    }
+    template <typename U>
+    bool operator!=(const BufferAllocator<U>& other) const { return !(*this == other); }
+};
+
+template <typename Key>
+using Buffer = std::vector<Key, BufferAllocator<Key>>;
+
+// Raw reading of a perf_event counter. All three values only grow, so differences between
+// two readings are never negative even when the kernel multiplexes the counter
+struct PerfReading {
+    uint64_t count = 0;
+    uint64_t time_enabled = 0;
+    uint64_t time_running = 0;
+};
+
+// Events between two readings, scaled up to the time enabled when the counter ran only part
+// of it. Scaling each interval instead of the totals keeps per-phase counts from going negative
+inline uint64_t scaled_delta(const PerfReading& before, const PerfReading& after) {
+    const uint64_t count = after.count - before.count;
+    const uint64_t enabled = after.time_enabled - before.time_enabled;
+    const uint64_t running = after.time_running - before.time_running;
+    if (running > 0 && running < enabled) {
+        return static_cast<uint64_t>(static_cast<double>(count) * enabled / running);
+    }
+    return count;
+}
+
+// Hardware event counter for the calling thread (Linux perf_event, user space only);
+// valid() is false where the kernel, its perf_event_paranoid setting or a container forbids it
+class PerfCounter {
+public:
+    PerfCounter() = default;
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+    PerfCounter(PerfCounter&& other) noexcept : fd_(other.fd_) { other.fd_ = -1; }
+    ~PerfCounter() { close(); }
+
+    bool open(uint32_t type, uint64_t config) {
+        close();
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)type;
+        (void)config;
+#endif
+        return valid();
+    }
+
+    bool valid() const { return fd_ >= 0; }
+
+    // Count and times so far, unscaled (see scaled_delta)
+    PerfReading read() const {
+        uint64_t values[3] = {0, 0, 0};  // Count, time enabled, time running
+        if (fd_ < 0 || ::read(fd_, values, sizeof(values)) != sizeof(values)) return PerfReading();
+        return {values[0], values[1], values[2]};
+    }
+
+private:
+    void close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    int fd_ = -1;
+};
+
+#ifdef __linux__
+// perf_event config for data TLB load misses
+constexpr uint64_t DTLB_LOAD_MISSES = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+#endif
+
+// Hardware events counted per worker and phase (Options::count_hardware_events)
+enum HardwareEvent { Cycles, Instructions, LlcMisses, BranchMisses, DtlbMisses, EventCount };
+
+inline const char* event_name(int event) {
+    static const char* const names[EventCount] = {"cycles", "instructions", "LLC misses", "branch misses",
+                                                  "dTLB load misses"};
+    return names[event];
+}
+
+// One counter per HardwareEvent for the calling thread. Events are opened separately, so a
+// kernel or VM lacking some of them only loses those; reads of invalid events return 0
+class PerfCounterSet {
+public:
+    void open() {
+#ifdef __linux__
+        counters_[Cycles].open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        counters_[Instructions].open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        counters_[LlcMisses].open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        counters_[BranchMisses].open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        counters_[DtlbMisses].open(PERF_TYPE_HW_CACHE, DTLB_LOAD_MISSES);
+#endif
+    }
+
+    bool valid(int event) const { return counters_[event].valid(); }
+
+    std::array<PerfReading, EventCount> read() const {
+        std::array<PerfReading, EventCount> values;
+        for (int event = 0; event < EventCount; ++event) values[event] = counters_[event].read();
+        return values;
+    }
+
+private:
+    std::array<PerfCounter, EventCount> counters_;
+};
+
+// SplitMix64 finalizer: every input bit affects every output bit
+inline uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Hash of one key for the multiset check. String references hash their arena position as
+// well as their prefix; a sort moves references but never changes them
+template <typename Key>
+uint64_t key_hash(const Key& key) {
+    if constexpr (std::is_same_v<Key, StringRef>) {
+        return mix64(key.prefix ^ mix64((uint64_t(key.offset) << 32) | key.length));
+    } else {
+        return mix64(KeyTraits<Key>::to_bits(key));
+    }
+}
+
+// Order-independent fingerprint of a multiset of keys: the sum and the xor of every key's
+// hash. Equal multisets always match; different ones collide with negligible probability
+struct Fingerprint {
+    size_t count = 0;
+    uint64_t sum = 0;
+    uint64_t xor_bits = 0;
+
+    void add(uint64_t hash) {
+        count++;
+        sum += hash;
+        xor_bits ^= hash;
+    }
+    void merge(const Fingerprint& other) {
+        count += other.count;
+        sum += other.sum;
+        xor_bits ^= other.xor_bits;
+    }
+    bool operator==(const Fingerprint& other) const {
+        return count == other.count && sum == other.sum && xor_bits == other.xor_bits;
+    }
+    bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+};
+
+// Timeline tracing is compiled in with -DHSS_TRACE and switched on by Options::trace; without
+// HSS_TRACE the recording calls compile to nothing
+#ifdef HSS_TRACE
+constexpr bool TRACE_SUPPORTED = true;
+#else
+constexpr bool TRACE_SUPPORTED = false;
+#endif
+
+// One span on a worker's timeline (a complete event in the Chrome trace format)
+struct TraceEvent {
+    const char* category;               // "phase", "barrier", "lock" or "splitter" (static string)
+    const char* name;                   // Static string
+    uint64_t begin_ns;                  // Since the sorter's trace epoch
+    uint64_t end_ns;
+    uint32_t sort;                      // Sort of the sorter the span belongs to, from 1
+    int32_t detail;                     // Splitter round or bucket of a cursor lock; -1 if none
+};
+
+// Fixed-capacity ring of one worker's trace events. Recording never allocates: once the
+// ring is full the oldest events are overwritten and counted as dropped
+class TraceBuffer {
+public:
+    void reserve(size_t capacity) {
+        if (events_.size() == capacity) return;
+        events_.assign(capacity, TraceEvent());
+        next_ = 0;
+        recorded_ = 0;
+    }
+
+    void record(const TraceEvent& event) {
+        if (events_.empty()) return;
+        events_[next_] = event;
+        next_ = next_ + 1 == events_.size() ? 0 : next_ + 1;
+        recorded_++;
+    }
+
+    // Visit the retained events, oldest first
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        size_t index = recorded_ > events_.size() ? next_ : 0;
+        for (size_t i = 0; i < size(); ++i) {
+            fn(events_[index]);
+            index = index + 1 == events_.size() ? 0 : index + 1;
+        }
+    }
+
+    size_t size() const { return std::min<uint64_t>(recorded_, events_.size()); }
+    uint64_t dropped() const { return recorded_ - size(); }
+
+private:
+    std::vector<TraceEvent> events_;
+    size_t next_ = 0;                   // Slot of the next event
+    uint64_t recorded_ = 0;             // Events ever recorded since reserve()
+};
+
+// Settings owned by one sorter
+struct Options {
+    int num_workers = 4;                // Number of parallel workers (threads)
+    int random_seed = 42;               // Seed for splitter sampling
+    double max_imbalance = 0.1;         // Allowed load imbalance ratio (ε), sets the oversampling
+    bool verbose_output = false;        // Enable detailed debug prints
+    std::vector<int> cpu_affinity;      // Pin worker i to cpu_affinity[i % size]; empty = no pinning
+    bool stable = false;                // Keep equal keys in input order (stable local sorts and merge)
+    // Optional probe returning the calling thread's heap allocation count (e.g. from a counting
+    // operator new); when set, allocations are recorded per worker and phase
+    uint64_t (*allocation_counter)() = nullptr;
+    HugePages huge_pages = HugePages::Off; // Page backing of local chunks and radix scratch
+    bool populate = false;              // Pre-fault large buffers when they are mapped
+    bool count_hardware_events = false; // Record HardwareEvent counts per phase through perf_event
+    // Sort stripes where they lie and exchange by permuting blocks within the input, so extra
+    // memory is O(p * BLOCK_BYTES) per worker instead of a chunk copy (ignored when stable)
+    bool in_place = false;
+    // Record phases, barrier waits, contended lock acquisitions and splitter rounds per worker
+    // for Sorter::write_trace (needs HSS_TRACE; ignored otherwise)
+    bool trace = false;
+    size_t trace_capacity = 1 << 16;    // Trace events kept per worker; older ones are dropped
+    size_t oversampling = 0;            // Samples per bucket; 0 derives it from n, p and ε (oversampling_ratio)
+    // Splitter selection rounds: above 1, the bucket histogram is checked after each round and
+    // a bucket over (1 + ε) n/p triggers another round with more samples
+    int max_splitter_rounds = 1;
+    // DistributedSorter: levels of splitting; 2 first partitions the ranks into about √p groups
+    int levels = 1;
+    // DistributedSorter: send the Phase 3 pieces of integer and floating-point keys delta-encoded
+    // and bit-packed (DeltaCodec); ignored for other keys
+    bool compress_exchange = false;
+};
+
+// Samples per bucket for which one round keeps every bucket within (1 + ε) n/p with probability
+// about 1 - 1/n: a bucket overflows only if fewer than s of the p * s samples fall into
+// (1 + ε) n/p consecutive elements, which a Chernoff bound puts at p * exp(-ε² s / (2 (1 + ε))).
+// Capped at n/p² so that the leader sorts no more samples than one worker's chunk
+inline size_t oversampling_ratio(size_t n, int p, double epsilon) {
+    if (n < 2 || p < 2) return 1;
+    epsilon = std::max(epsilon, 1e-3);
+    const double ratio = 2 * (1 + epsilon) / (epsilon * epsilon) * std::log(static_cast<double>(p) * n);
+    const size_t cap = std::max<size_t>(1, n / (static_cast<size_t>(p) * p));
+    return std::min(static_cast<size_t>(std::ceil(ratio)), cap);
+}
+
+constexpr size_t BLOCK_BYTES = 4096;    // Block size of the in-place exchange
+
+// Algorithm phases, used to index per-phase counters
+enum Phase { Phase1, Phase2a, Phase2b, Phase3, Phase4, PhaseCount };
+
+inline const char* phase_name(int phase) {
+    static const char* const names[PhaseCount] = {"Phase 1", "Phase 2a", "Phase 2b", "Phase 3", "Phase 4"};
+    return names[phase];
+}
+
+// Synchronization cost of one worker in one phase. Barrier waits are charged to the phase the
+// worker was finishing; locks are the sample pool lock and the in-place block cursor locks
+struct SyncCounters {
+    uint64_t barrier_waits = 0;
+    uint64_t barrier_wait_ns = 0;       // Time blocked in pthread_barrier_wait
+    uint64_t lock_acquisitions = 0;
+    uint64_t contended_acquisitions = 0; // Acquisitions that found the lock held
+    uint64_t lock_wait_ns = 0;          // Time waiting for the holder on contended acquisitions
+};
+
+// Bump allocator for per-sort scratch of trivially destructible types. reset() releases
+// everything at once and keeps the memory; if a sort spilled into several blocks they are
+// replaced by one block of the combined size, so the next sort of the same shape fits
+// without touching the heap
+class Arena {
+public:
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena memory is released without destructors");
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned type");
+        const size_t bytes = count * sizeof(T);
+        size_t offset = (used_ + alignof(T) - 1) & ~(alignof(T) - 1);
+        if (blocks_.empty() || offset + bytes > blocks_.back().size) {
+            const size_t previous = blocks_.empty() ? 0 : blocks_.back().size;
+            add_block(std::max({bytes, 2 * previous, MIN_BLOCK_BYTES}));
+            offset = 0;
+        }
+        used_ = offset + bytes;
+        return reinterpret_cast<T*>(blocks_.back().data.get() + offset);
+    }
+
+    void reset() {
+        if (blocks_.size() > 1) {
+            size_t total = 0;
+            for (const Block& block : blocks_) total += block.size;
+            blocks_.clear();
+            add_block(total);
+        }
+        used_ = 0;
+    }
+
+    uint64_t block_allocations() const { return block_allocations_; } // Heap blocks ever requested
+
+private:
+    static constexpr size_t MIN_BLOCK_BYTES = 4096;
+
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    void add_block(size_t size) {
+        blocks_.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+        block_allocations_++;
+    }
+
+    std::vector<Block> blocks_;
+    size_t used_ = 0;                   // Bytes handed out from the last block
+    uint64_t block_allocations_ = 0;
+};
+
+// Sample or splitter tagged with its origin; (key, worker, position) is unique for every
+// element, so ties between equal keys are broken by input order
+template <typename Key>
+struct Sample {
+    Key key;
+    int worker;                         // Worker whose chunk holds the element
+    size_t position;                    // Index in that worker's sorted chunk
+};
+
+namespace detail {
+
+// Order of samples and splitters: by key, then by source worker (or rank) and position, i.e.
+// input order. Every sorter uses it, so equal keys are split between buckets the same way
+template <typename Key, typename Less>
+bool sample_less(const Sample<Key>& a, const Sample<Key>& b, const Less& less) {
+    if (less(a.key, b.key)) return true;
+    if (less(b.key, a.key)) return false;
+    return a.worker != b.worker ? a.worker < b.worker : a.position < b.position;
+}
+
+// Elements of worker worker_id's sorted chunk ordered before splitter under sample_less
+template <typename Key, typename Less>
+size_t splitter_bound(const Sample<Key>& splitter, const Key* chunk, size_t n, int worker_id, const Less& less) {
+    // Equal keys here come after the splitter's copy in input order
+    if (splitter.worker < worker_id) return std::lower_bound(chunk, chunk + n, splitter.key, less) - chunk;
+    if (splitter.worker > worker_id) return std::upper_bound(chunk, chunk + n, splitter.key, less) - chunk;
+    return splitter.position;
+}
+
+// Bounds of the buckets of a sorted chunk: bucket b is chunk[bounds[b], bounds[b + 1]), with
+// bounds holding buckets + 1 entries. One binary search per splitter; missing splitters leave
+// the last buckets empty
+template <typename Key, typename Less>
+void bucket_bounds(const Sample<Key>* splitters, size_t splitter_count, const Key* chunk, size_t n,
+                   int worker_id, int buckets, const Less& less, size_t* bounds) {
+    std::fill(bounds, bounds + buckets + 1, n);
+    bounds[0] = 0;
+    for (size_t i = 0; i < splitter_count && i + 1 < (size_t)buckets; ++i) {
+        bounds[i + 1] = std::max(splitter_bound(splitters[i], chunk, n, worker_id, less), bounds[i]);
+    }
+}
+
+} // namespace detail
+
+// Per-thread execution state
+template <typename Key>
+struct WorkerContext {
+    int worker_id;                      // Unique worker ID (0 to num_workers-1)
+    Buffer<Key> local_chunk;            // Subset of data assigned to this worker, sorted in Phase 1
+    Key* chunk;                         // Sorted chunk: local_chunk, or the worker's stripe of the input in place
+    size_t chunk_size;
+    std::vector<Sample<Key>> local_samples; // Locally sampled pivot candidates
+    Buffer<Key> scratch;                // Ping-pong buffer for the radix backend
+    Arena arena;                        // Per-sort scratch, reset at the start of every sort
+    size_t* bucket_bounds;              // Bucket b is chunk[bounds[b], bounds[b+1]) (in arena)
+    // In-place exchange state
+    std::vector<Key> blocks;            // Bucket remainders, two swap blocks and an overflow block
+    size_t* full_blocks;                // Whole blocks per bucket packed at the stripe front (in arena)
+    size_t* remainder_bounds;           // Remainders of bucket b are blocks[bounds[b], bounds[b+1]) (in arena)
+    size_t packed_blocks;               // Whole blocks at the stripe front after compaction
+    size_t overflow_size;               // Elements of the bucket's last block that ran into the next bucket
+    size_t bucket_size;                 // Elements in this worker's final bucket
+    size_t sorted_size;                 // Elements of the bucket inside the sorted range (all of it in a full sort)
+    bool equality_bucket;               // Bucket lies between equal splitters and was not sorted
+    size_t range_below;                 // Partial sort: chunk elements Phase 1 dropped below the range
+    // Timing variables (in seconds) for each phase
+    double phase1_duration;             // Initial partitioning and local sorting
+    double phase2a_duration;            // Sample selection and contribution
+    double phase2b_duration;            // Splitter selection (leader only)
+    double phase3_duration;             // Partitioning and data exchange
+    double phase4_duration;             // Final bucket sorting and write-back
+    // Resource use of this worker's thread per phase (indexed by Phase)
+    std::array<uint64_t, PhaseCount> phase_allocations; // Heap allocations (needs Options::allocation_counter)
+    std::array<uint64_t, PhaseCount> phase_page_faults; // Minor + major page faults (Linux)
+    // Hardware events per phase, indexed by HardwareEvent (Options::count_hardware_events)
+    std::array<std::array<uint64_t, EventCount>, PhaseCount> phase_events;
+    PerfCounterSet perf_counters;       // Opened by the worker thread on its first sort
+    bool perf_counters_tried = false;
+    std::array<SyncCounters, PhaseCount> phase_sync; // Barrier and lock waits per phase
+    TraceBuffer trace;                  // Timeline of this worker (Options::trace)
+};
+
+// Parallel sorter owning its configuration, synchronization, buffers and thread pool.
+// Pool threads are started on first use and reused by every later sort, and all buffers
+// keep their capacity, so repeated sorts of the same size do not allocate after warm-up.
+template <typename Key, typename Less = KeyLess<Key>>
+class Sorter {
+public:
+    explicit Sorter(const Options& options = Options(), Less less = Less())
+        : options_(options), less_(std::move(less)),
+          num_workers_(std::max(1, options.num_workers)) {
+        pthread_barrier_init(&barrier_, nullptr, num_workers_);
+        pthread_barrier_init(&start_barrier_, nullptr, num_workers_ + 1);
+        pthread_barrier_init(&done_barrier_, nullptr, num_workers_ + 1);
+        pthread_mutex_init(&lock_, nullptr);
+        cursors_ = std::vector<BlockCursor>(num_workers_);
+        for (auto& cursor : cursors_) pthread_mutex_init(&cursor.lock, nullptr);
+        contexts_.resize(num_workers_);
+        const BufferAllocator<Key> allocator(options_.huge_pages, options_.populate);
+        for (int i = 0; i < num_workers_; ++i) {
+            contexts_[i].worker_id = i;
+            contexts_[i].local_chunk = Buffer<Key>(allocator);
+            contexts_[i].scratch = Buffer<Key>(allocator);
+        }
+    }
+
+    ~Sorter() {
+        if (!threads_.empty()) {
+            shutdown_ = true;
+            pthread_barrier_wait(&start_barrier_);
+            for (auto& thread : threads_) pthread_join(thread, nullptr);
+        }
+        pthread_barrier_destroy(&barrier_);
+        pthread_barrier_destroy(&start_barrier_);
+        pthread_barrier_destroy(&done_barrier_);
+        pthread_mutex_destroy(&lock_);
+        for (auto& cursor : cursors_) pthread_mutex_destroy(&cursor.lock);
+    }
+
+    Sorter(const Sorter&) = delete;
+    Sorter& operator=(const Sorter&) = delete;
+
+    // Sort data[0, n) in place with the four HSS phases
+    void sort(Key* data, size_t n) { sort_range(data, n, 0, n); }
+
+    // Partial sort: leave data[lo, hi) exactly as sort() would and the rest of data[0, n)
+    // unspecified (not even a permutation of the input unless in place). Phase 1 keeps only the
+    // keys between two sampled bounds around the range, Phase 2 aligns the splitters with lo and
+    // hi, Phase 3 copies no bucket outside the range and Phase 4 orders only the part of a bucket
+    // inside it. In place, every key is kept and permuted; stable sorts merge whole buckets
+    void sort_range(Key* data, size_t n, size_t lo, size_t hi) {
+        // Reset state left over from a previous sort
+        data_ = data;
+        size_ = n;
+        range_begin_ = std::min(lo, n);
+        range_end_ = std::min(std::max(hi, range_begin_), n);
+        range_base_ = 0;
+        kept_ = n;
+        range_fallback_ = false;
+        sorts_++;
+        sample_pool_.clear();
+        splitters_.clear();
+        splitter_rounds_ = 0;
+        oversampling_ = options_.oversampling > 0 ? options_.oversampling
+                                                  : oversampling_ratio(n, num_workers_, options_.max_imbalance);
+        for (auto& ctx : contexts_) {
+            ctx.phase1_duration = 0.0;  // Initialize timing variables
+            ctx.phase2a_duration = 0.0;
+            ctx.phase2b_duration = 0.0;
+            ctx.phase3_duration = 0.0;
+            ctx.phase4_duration = 0.0;
+            ctx.phase_allocations.fill(0);
+            ctx.phase_page_faults.fill(0);
+            for (auto& events : ctx.phase_events) events.fill(0);
+            ctx.phase_sync.fill(SyncCounters());
+            ctx.arena.reset();
+#ifdef HSS_TRACE
+            if (options_.trace) ctx.trace.reserve(options_.trace_capacity);
+#endif
+        }
+        if (in_place()) {
+            block_buckets_.resize((n + block_size() - 1) / block_size());
+            tail_block_.resize(block_size());
+        }
+        for_each_worker([this](int worker_id) { run_worker(worker_id); });
+    }
+
+    // Size every worker's chunk and scratch buffer (block buffer in place) for sorts of n
+    // elements and touch them in parallel on the pool, so first-touch page faults leave
+    // Phase 1 and Phase 4
+    void prepare(size_t n) {
+        for_each_worker([this, n](int worker_id) {
+            WorkerContext<Key>& ctx = contexts_[worker_id];
+            if (in_place()) {
+                ctx.blocks.resize((num_workers_ + 3) * block_size());
+                return;
+            }
+            // Headroom for Phase 4 buckets, which sampling leaves up to ~1.3x the average; the
+            // radix sort swaps chunk and scratch, so both get it
+            const size_t chunk_size = n / num_workers_ + n % num_workers_;
+            const size_t capacity = chunk_size + chunk_size / 2;
+            ctx.local_chunk.resize(capacity);
+            ctx.local_chunk.clear();
+            if constexpr (std::is_same_v<Less, KeyLess<Key>>) {
+                if constexpr (KeyTraits<Key>::backend == SortBackend::Radix) {
+                    ctx.scratch.resize(capacity);
+                    ctx.scratch.clear();
+                }
+            }
+        });
+    }
+
+    // Run fn(worker_id) once on every pool thread and wait until all of them return
+    template <typename Fn>
+    void for_each_worker(Fn&& fn) {
+        using Function = std::remove_reference_t<Fn>;
+        start_pool();
+        job_.run = [](void* state, int worker_id) { (*static_cast<Function*>(state))(worker_id); };
+        job_.state = const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+        pthread_barrier_wait(&start_barrier_);
+        pthread_barrier_wait(&done_barrier_);
+    }
+
+    int num_workers() const { return num_workers_; }
+    const Options& options() const { return options_; }
+    const Less& less() const { return less_; }
+    const std::vector<Sample<Key>>& splitters() const { return splitters_; }
+    // Per-worker state and counters of the last sort
+    const std::vector<WorkerContext<Key>>& workers() const { return contexts_; }
+
+    // Parallel validation on the pool, O(n/p) per worker. Take the fingerprint of the input
+    // before sorting and compare it with the output's; together with is_sorted() this replaces
+    // sorting a copy with std::sort and comparing element by element
+    Fingerprint fingerprint(const Key* data, size_t n) {
+        std::vector<Fingerprint> parts(num_workers_);
+        for_each_worker([&](int worker_id) {
+            Fingerprint part;
+            const size_t end = n * (worker_id + 1) / num_workers_;
+            for (size_t i = n * worker_id / num_workers_; i < end; ++i) {
+                part.add(key_hash(data[i]));
+            }
+            parts[worker_id] = part;
+        });
+        Fingerprint total;
+        for (const Fingerprint& part : parts) total.merge(part);
+        return total;
+    }
+
+    // True if data[0, n) is in order. Each worker checks a slice and the pair across its left
+    // edge, so every adjacent pair is covered, including those across bucket boundaries
+    bool is_sorted(const Key* data, size_t n) {
+        std::vector<char> sorted(num_workers_, 1);
+        for_each_worker([&](int worker_id) {
+            const size_t begin = std::max<size_t>(1, n * worker_id / num_workers_);
+            const size_t end = n * (worker_id + 1) / num_workers_;
+            for (size_t i = begin; i < end; ++i) {
+                if (less_(data[i], data[i - 1])) {
+                    sorted[worker_id] = 0;
+                    return;
+                }
+            }
+        });
+        return std::all_of(sorted.begin(), sorted.end(), [](char ok) { return ok != 0; });
+    }
+    // Time spent creating the pool threads (zero until the first sort)
+    double pool_startup_duration() const { return pool_startup_duration_; }
+    // Rounds of splitter selection in the last sort
+    int splitter_rounds() const { return splitter_rounds_; }
+    // Samples the splitters of the last sort were chosen from (in its last round)
+    size_t sample_size() const { return sample_pool_.size(); }
+    // Samples per bucket in the last round of the last sort
+    size_t oversampling() const { return oversampling_; }
+    // Output ranks [range_begin, range_end) the last sort ordered (all of them unless partial)
+    size_t range_begin() const { return range_begin_; }
+    size_t range_end() const { return range_end_; }
+    // Elements Phase 1 of the last sort kept, and the global rank of the smallest of them
+    size_t kept_size() const { return kept_; }
+    size_t kept_offset() const { return range_base_; }
+    // True if the sampled bounds of the last partial sort missed the range and every key was kept
+    bool range_fallback() const { return range_fallback_; }
+
+    // Global rank of every splitter in the last sort: the output offset of the bucket above it.
+    // Splitter i ideally has rank (i + 1) * n / p
+    std::vector<size_t> splitter_ranks() const {
+        std::vector<size_t> ranks;
+        for (int bucket = 1; bucket < num_workers_; ++bucket) ranks.push_back(range_base_ + bucket_offset(bucket));
+        return ranks;
+    }
+
+    // Write every worker's retained trace events as Chrome trace JSON (chrome://tracing,
+    // ui.perfetto.dev): one thread per worker, timestamps in microseconds since the sorter
+    // was built. Call between sorts
+    void write_trace(std::ostream& out) const {
+        out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+        for (const auto& ctx : contexts_) {
+            out << (ctx.worker_id > 0 ? ",\n" : "") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+                << ctx.worker_id << ", \"args\": {\"name\": \"Worker " << ctx.worker_id << "\"}}";
+        }
+        uint64_t dropped = 0;
+        for (const auto& ctx : contexts_) {
+            dropped += ctx.trace.dropped();
+            ctx.trace.for_each([&](const TraceEvent& event) {
+                char line[256];
+                std::snprintf(line, sizeof(line),
+                              ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                              "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"sort\": %u",
+                              event.name, event.category, ctx.worker_id, event.begin_ns / 1e3,
+                              (event.end_ns - event.begin_ns) / 1e3, event.sort);
+                out << line;
+                if (event.detail >= 0) {
+                    out << ", \"" << (std::strcmp(event.category, "splitter") == 0 ? "round" : "bucket")
+                        << "\": " << event.detail;
+                }
+                out << "}}";
+            });
+        }
+        out << "\n], \"otherData\": {\"dropped_events\": " << dropped << "}}\n";
+    }
+
+private:
+    // Work handed to the pool: a plain function pointer plus state, called once per worker
+    struct Job {
+        void (*run)(void* state, int worker_id);
+        void* state;
+    };
+
+    struct Launch {
+        Sorter* sorter;
+        int worker_id;
+    };
+
+    // In-place exchange: cursors into one bucket's block region. Slots before write hold
+    // placed blocks, slots [write, read) blocks still to be moved, and later slots are free
+    struct BlockCursor {
+        size_t write;
+        size_t read;
+        int reading;                    // Workers still copying a block they took from this region
+        pthread_mutex_t lock;
+    };
+
+    // Allocation, page fault and hardware event counters of the calling thread
+    struct ResourceUsage {
+        uint64_t allocations;
+        uint64_t page_faults;
+        std::array<PerfReading, EventCount> events; // Raw counter readings
+    };
+
+    void start_pool() {
+        if (!threads_.empty()) return;
+        auto start_pool = Clock::now();
+        threads_.resize(num_workers_);
+        launches_.resize(num_workers_);
+        for (int i = 0; i < num_workers_; ++i) {
+            launches_[i] = {this, i};
+            pthread_create(&threads_[i], nullptr, pool_thread, &launches_[i]);
+#ifdef __linux__
+            if (!options_.cpu_affinity.empty()) {
+                cpu_set_t cpus;
+                CPU_ZERO(&cpus);
+                CPU_SET(options_.cpu_affinity[i % options_.cpu_affinity.size()], &cpus);
+                pthread_setaffinity_np(threads_[i], sizeof(cpus), &cpus);
+            }
+#endif
+        }
+        pool_startup_duration_ = Duration(Clock::now() - start_pool).count();
+    }
+
+    // Pool threads wait for a job, run it, and report back until the sorter shuts down
+    static void* pool_thread(void* arg) {
+        Launch* launch = static_cast<Launch*>(arg);
+        Sorter* sorter = launch->sorter;
+        while (true) {
+            pthread_barrier_wait(&sorter->start_barrier_);
+            if (sorter->shutdown_) break;
+            sorter->job_.run(sorter->job_.state, launch->worker_id);
+            pthread_barrier_wait(&sorter->done_barrier_);
+        }
+        return nullptr;
+    }
+
+    // Print debug messages if verbose mode is enabled
+    void debug_print(const std::string& message) const {
+        if (options_.verbose_output) {
+            std::cerr << "[DEBUG] " << message << "\n";
+        }
+    }
+
+    ResourceUsage resource_usage(const WorkerContext<Key>* ctx) const {
+        ResourceUsage usage = {options_.allocation_counter ? options_.allocation_counter() : 0, 0,
+                               ctx->perf_counters.read()};
+#ifdef RUSAGE_THREAD
+        rusage self;
+        if (getrusage(RUSAGE_THREAD, &self) == 0) {
+            usage.page_faults = self.ru_minflt + self.ru_majflt;
+        }
+#endif
+        return usage;
+    }
+
+    // Charge the counters accumulated since usage to phase and restart from now; Phase 2 adds
+    // up over splitter rounds
+    void end_phase(WorkerContext<Key>* ctx, Phase phase, ResourceUsage& usage) const {
+        const ResourceUsage now = resource_usage(ctx);
+        ctx->phase_allocations[phase] += now.allocations - usage.allocations;
+        ctx->phase_page_faults[phase] += now.page_faults - usage.page_faults;
+        for (int event = 0; event < EventCount; ++event) {
+            ctx->phase_events[phase][event] += scaled_delta(usage.events[event], now.events[event]);
+        }
+        usage = now;
+    }
+
+    static uint64_t nanoseconds(Clock::duration duration) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+
+    // Record the span [begin, end) on the worker's timeline
+    void trace(WorkerContext<Key>* ctx, const char* category, const char* name, Clock::time_point begin,
+               Clock::time_point end, int detail = -1) const {
+#ifdef HSS_TRACE
+        if (!options_.trace) return;
+        ctx->trace.record({category, name, nanoseconds(begin - trace_epoch_), nanoseconds(end - trace_epoch_), sorts_, detail});
+#else
+        (void)ctx, (void)category, (void)name, (void)begin, (void)end, (void)detail;
+#endif
+    }
+
+    // Wait at the phase barrier and charge the wait to phase; stragglers show up as the time
+    // the others spend here
+    void wait_barrier(WorkerContext<Key>* ctx, Phase phase, const char* name) {
+        const auto begin = Clock::now();
+        pthread_barrier_wait(&barrier_);
+        const auto end = Clock::now();
+        SyncCounters& sync = ctx->phase_sync[phase];
+        sync.barrier_waits++;
+        sync.barrier_wait_ns += nanoseconds(end - begin);
+        trace(ctx, "barrier", name, begin, end);
+    }
+
+    // Acquire a mutex. An uncontended acquisition costs a successful trylock; only contended
+    // ones read the clock and are traced, as the wait for the holder, which keeps the per-block
+    // cursor locks of the in-place exchange cheap to count
+    void lock_mutex(WorkerContext<Key>* ctx, Phase phase, pthread_mutex_t* mutex, const char* name, int bucket = -1) {
+        SyncCounters& sync = ctx->phase_sync[phase];
+        sync.lock_acquisitions++;
+        if (pthread_mutex_trylock(mutex) == 0) return;
+        const auto begin = Clock::now();
+        pthread_mutex_lock(mutex);
+        const auto end = Clock::now();
+        sync.contended_acquisitions++;
+        sync.lock_wait_ns += nanoseconds(end - begin);
+        trace(ctx, "lock", name, begin, end, bucket);
+    }
+
+    // One worker's share of the HSS algorithm with timing
+    void run_worker(int worker_id) {
+        WorkerContext<Key>* ctx = &contexts_[worker_id];
+        const int total_workers = num_workers_;
+#ifdef __linux__
+        if (options_.count_hardware_events && !ctx->perf_counters_tried) {
+            ctx->perf_counters_tried = true;
+            ctx->perf_counters.open();
+        }
+#endif
+        ResourceUsage usage = resource_usage(ctx);
+
+        // Phase 1: Initial Data Partitioning and Local Sorting
+        auto start_phase1 = Clock::now();
+        const size_t chunk_start = chunk_begin(worker_id);
+        const size_t chunk_end = chunk_begin(worker_id + 1);
+        if (in_place()) {
+            // The stripe is sorted where it lies: no chunk copy and no radix scratch
+            ctx->chunk = data_ + chunk_start;
+            ctx->chunk_size = chunk_end - chunk_start;
+            in_place_sort(ctx->chunk, ctx->chunk_size, less_);
+        } else {
+            if (partial()) {
+                keep_range(ctx, chunk_start, chunk_end);
+            } else {
+                ctx->local_chunk.assign(data_ + chunk_start, data_ + chunk_end);
+            }
+            local_sort(ctx->local_chunk, ctx->scratch, less_, options_.stable);
+            ctx->chunk = ctx->local_chunk.data();
+            ctx->chunk_size = ctx->local_chunk.size();
+        }
+        auto end_phase1 = Clock::now();
+        ctx->phase1_duration = Duration(end_phase1 - start_phase1).count();
+        end_phase(ctx, Phase1, usage);
+        trace(ctx, "phase", phase_name(Phase1), start_phase1, end_phase1);
+
+        if (options_.verbose_output) {
+            debug_print("Worker " + std::to_string(worker_id) +
+                        " initial chunk size: " + std::to_string(ctx->chunk_size));
+            print_vector("Worker " + std::to_string(worker_id) + " initial chunk",
+                         std::vector<Key>(ctx->chunk, ctx->chunk + ctx->chunk_size), less_);
+        }
+
+        wait_barrier(ctx, Phase1, "Phase 1 barrier"); // Barrier after Phase 1
+
+        // Phase 2, repeated with more samples while the bucket histogram misses the ε target
+        // (Options::max_splitter_rounds)
+        bool bounds_published = false;
+        for (int round = 1;; ++round) {
+            // Phase 2a: Sample Selection and Contribution
+            auto start_phase2a = Clock::now();
+            ctx->local_samples.clear();
+            // Selection sampling over the sorted chunk (as std::sample does) keeping each position;
+            // use a worker- and round-specific seed for reproducibility
+            std::mt19937 rng(options_.random_seed + worker_id + (round - 1) * total_workers);
+            const size_t chunk_size = ctx->chunk_size;
+            size_t needed = std::min(oversampling_, chunk_size);
+            for (size_t i = 0; i < chunk_size && needed > 0; ++i) {
+                if (std::uniform_int_distribution<size_t>(0, chunk_size - i - 1)(rng) < needed) {
+                    ctx->local_samples.push_back({ctx->chunk[i], worker_id, i});
+                    needed--;
+                }
+            }
+
+            // Contribute samples to the shared pool (thread-safe)
+            lock_mutex(ctx, Phase2a, &lock_, "Sample pool lock");
+            sample_pool_.insert(sample_pool_.end(), ctx->local_samples.begin(), ctx->local_samples.end());
+            pthread_mutex_unlock(&lock_);
+            auto end_phase2a = Clock::now();
+            ctx->phase2a_duration += Duration(end_phase2a - start_phase2a).count();
+            end_phase(ctx, Phase2a, usage);
+            trace(ctx, "phase", phase_name(Phase2a), start_phase2a, end_phase2a);
+
+            wait_barrier(ctx, Phase2a, "Sample barrier"); // Barrier after sample contribution
+
+            // Phase 2b: Splitter Selection by Leader
+            auto start_phase2b = Clock::now();
+            if (worker_id == 0) {
+                std::sort(sample_pool_.begin(), sample_pool_.end(), [this](const Sample<Key>& a, const Sample<Key>& b) {
+                    return sample_less(a, b);
+                });
+                // Splitters are distinct samples even when their keys repeat: a hot key that spans
+                // several splitters is split by (worker, position) instead of landing in one bucket
+                splitter_rounds_ = round;
+                choose_splitters();
+                trace(ctx, "splitter", "Splitter round", start_phase2b, Clock::now(), splitter_rounds_);
+                if (options_.verbose_output) {
+                    std::vector<Key> splitter_keys;
+                    for (const auto& splitter : splitters_) splitter_keys.push_back(splitter.key);
+                    print_vector("Selected splitters", splitter_keys, less_);
+                }
+            }
+            auto end_phase2b = Clock::now();
+            if (worker_id == 0) ctx->phase2b_duration += Duration(end_phase2b - start_phase2b).count();
+            end_phase(ctx, Phase2b, usage);
+            trace(ctx, "phase", phase_name(Phase2b), start_phase2b, end_phase2b);
+
+            wait_barrier(ctx, Phase2b, "Splitter barrier"); // Barrier after splitter selection
+            // The ε target is about the buckets of a full sort; a partial sort takes one round
+            if (options_.max_splitter_rounds <= 1 || partial()) break;
+
+            // Histogram of the round: every worker publishes its bucket bounds and the leader
+            // decides whether to sample again (charged to Phase 2b, the leader's to its time)
+            auto start_histogram = Clock::now();
+            compute_bucket_bounds(ctx);
+            wait_barrier(ctx, Phase2b, "Histogram barrier");
+            if (worker_id == 0) refine_ = needs_refinement(round);
+            auto end_histogram = Clock::now();
+            if (worker_id == 0) ctx->phase2b_duration += Duration(end_histogram - start_histogram).count();
+            end_phase(ctx, Phase2b, usage);
+            trace(ctx, "phase", "Histogram", start_histogram, end_histogram);
+            wait_barrier(ctx, Phase2b, "Refinement barrier");
+            bounds_published = true;
+            if (!refine_) break;
+        }
+
+        // Phase 3: Partition and Exchange Data
+        auto start_phase3 = Clock::now();
+        if (!bounds_published) compute_bucket_bounds(ctx);
+        if (!options_.stable) {
+            // Every worker's bucket counts are published
+            if (!bounds_published) wait_barrier(ctx, Phase3, "Bucket count barrier");
+            if (in_place()) {
+                permute_blocks(ctx);
+            } else {
+                exchange(ctx);
+            }
+        }
+        auto end_phase3 = Clock::now();
+        ctx->phase3_duration = Duration(end_phase3 - start_phase3).count();
+        end_phase(ctx, Phase3, usage);
+        trace(ctx, "phase", phase_name(Phase3), start_phase3, end_phase3);
+
+        wait_barrier(ctx, Phase3, "Exchange barrier"); // Barrier after data exchange
+
+        // Phase 4: Final Sorting of Assigned Bucket
+        auto start_phase4 = Clock::now();
+        if (options_.stable) {
+            merge_bucket_stable(ctx);
+        } else {
+            sort_bucket(ctx);
+        }
+        auto end_phase4 = Clock::now();
+        ctx->phase4_duration = Duration(end_phase4 - start_phase4).count();
+        end_phase(ctx, Phase4, usage);
+        trace(ctx, "phase", phase_name(Phase4), start_phase4, end_phase4);
+
+        if (options_.verbose_output) {
+            debug_print("Worker " + std::to_string(worker_id) +
+                        " final chunk size: " + std::to_string(ctx->bucket_size));
+            const Key* bucket = data_ + range_base_ + bucket_offset(worker_id);
+            print_vector("Worker " + std::to_string(worker_id) + " final chunk",
+                         std::vector<Key>(bucket, bucket + ctx->bucket_size), less_);
+        }
+    }
+
+    bool in_place() const { return options_.in_place && !options_.stable; }
+
+    // Only part of the output ranks is wanted (sort_range)
+    bool partial() const { return range_begin_ > 0 || range_end_ < size_; }
+
+    // Samples to step past the sample at quantile q of `samples` so that the chosen one lands on
+    // the far side of the rank it stands for: sample quantiles deviate by about √(s q (1 - q))
+    // samples, and four deviations make a miss rarer than 1 in 10^4
+    static size_t rank_margin(double q, size_t samples) {
+        return static_cast<size_t>(std::ceil(4 * std::sqrt(samples * q * (1 - q)))) + 1;
+    }
+
+    // Phase 1 of a partial sort: copy only the chunk's keys between two bounds sampled around the
+    // range, so that the local sort and all later phases see a fraction of the input. Keys below
+    // the lower bound are counted, which fixes the global rank of the smallest kept key exactly;
+    // if the bounds missed the range after all, every key is kept (range_fallback)
+    void keep_range(WorkerContext<Key>* ctx, size_t chunk_start, size_t chunk_end) {
+        const int worker_id = ctx->worker_id;
+        // The chunk is unsorted, so random positions are a uniform sample
+        ctx->local_samples.clear();
+        const size_t chunk_size = chunk_end - chunk_start;
+        if (chunk_size > 0) {
+            std::mt19937 rng(options_.random_seed - 1 - worker_id);
+            std::uniform_int_distribution<size_t> position(chunk_start, chunk_end - 1);
+            for (size_t i = 0; i < oversampling_; ++i) {
+                const size_t index = position(rng);
+                ctx->local_samples.push_back({data_[index], worker_id, index});
+            }
+        }
+        lock_mutex(ctx, Phase1, &lock_, "Sample pool lock");
+        sample_pool_.insert(sample_pool_.end(), ctx->local_samples.begin(), ctx->local_samples.end());
+        pthread_mutex_unlock(&lock_);
+        wait_barrier(ctx, Phase1, "Range sample barrier");
+
+        if (worker_id == 0) choose_range_bounds();
+        wait_barrier(ctx, Phase1, "Range bound barrier");
+
+        const Key* low = range_low_ < sample_pool_.size() ? &sample_pool_[range_low_].key : nullptr;
+        const Key* high = range_high_ < sample_pool_.size() ? &sample_pool_[range_high_].key : nullptr;
+        ctx->local_chunk.clear();
+        ctx->range_below = 0;
+        for (size_t i = chunk_start; i < chunk_end; ++i) {
+            const Key& key = data_[i];
+            if (low && less_(key, *low)) {
+                ctx->range_below++;
+            } else if (!high || !less_(*high, key)) {
+                ctx->local_chunk.push_back(key);
+            }
+        }
+        wait_barrier(ctx, Phase1, "Range count barrier");
+
+        if (worker_id == 0) {
+            range_base_ = 0;
+            kept_ = 0;
+            for (const auto& source : contexts_) {
+                range_base_ += source.range_below;
+                kept_ += source.local_chunk.size();
+            }
+            if (range_base_ > range_begin_ || range_base_ + kept_ < range_end_) {
+                debug_print("Sampled bounds missed the range, keeping every key");
+                range_fallback_ = true;
+                range_base_ = 0;
+                kept_ = size_;
+            }
+            sample_pool_.clear();
+            // Phase 2 splits the kept keys only
+            oversampling_ = options_.oversampling > 0 ? options_.oversampling
+                                                      : oversampling_ratio(kept_, num_workers_, options_.max_imbalance);
+        }
+        wait_barrier(ctx, Phase1, "Range fallback barrier");
+        if (range_fallback_) ctx->local_chunk.assign(data_ + chunk_start, data_ + chunk_end);
+    }
+
+    // Leader, Phase 1 of a partial sort: pick the samples a margin below lo and above hi as the
+    // bounds of the kept keys, or none where the range reaches an end of the input
+    void choose_range_bounds() {
+        std::sort(sample_pool_.begin(), sample_pool_.end(), [this](const Sample<Key>& a, const Sample<Key>& b) {
+            return sample_less(a, b);
+        });
+        const size_t total_samples = sample_pool_.size();
+        range_low_ = range_high_ = SIZE_MAX;
+        if (total_samples == 0) return;
+        const double low = static_cast<double>(range_begin_) / size_;
+        const double high = static_cast<double>(range_end_) / size_;
+        const size_t low_index = static_cast<size_t>(low * total_samples);
+        const size_t low_margin = rank_margin(low, total_samples);
+        if (range_begin_ > 0 && low_index >= low_margin) range_low_ = low_index - low_margin;
+        const size_t high_index = static_cast<size_t>(std::ceil(high * total_samples)) + rank_margin(high, total_samples);
+        if (range_end_ < size_ && high_index < total_samples) range_high_ = high_index;
+    }
+
+    // Leader, Phase 2b: p - 1 distinct samples as splitters. A full sort takes every (S/p)-th
+    // sample. A partial sort spends the buckets on the range instead: the kept keys below lo and
+    // above hi get a bucket each, bounded by the sample a margin outside the range, and the other
+    // buckets split the range evenly
+    void choose_splitters() {
+        const size_t total_samples = sample_pool_.size();
+        if (total_samples == 0) return;
+        const int total_workers = num_workers_;
+        if (!partial() || kept_ == 0) {
+            for (int i = 1; i < total_workers; ++i) {
+                splitters_.push_back(sample_pool_[i * total_samples / total_workers]);
+            }
+            return;
+        }
+        // The range as quantiles of the kept keys
+        const double low = static_cast<double>(range_begin_ - range_base_) / kept_;
+        const double high = static_cast<double>(range_end_ - range_base_) / kept_;
+        const size_t low_index = static_cast<size_t>(low * total_samples);
+        const size_t low_margin = rank_margin(low, total_samples);
+        const size_t high_index = static_cast<size_t>(std::ceil(high * total_samples)) + rank_margin(high, total_samples);
+        const bool below = total_workers > 1 && range_begin_ > range_base_ && low_index >= low_margin;
+        const bool above = range_end_ < range_base_ + kept_ && high_index < total_samples && total_workers > 1 + below;
+        const int inner = total_workers - below - above;
+        if (below) splitters_.push_back(sample_pool_[low_index - low_margin]);
+        for (int i = 1; i < inner; ++i) {
+            const double quantile = low + (high - low) * i / inner;
+            splitters_.push_back(sample_pool_[std::min(static_cast<size_t>(quantile * total_samples), total_samples - 1)]);
+        }
+        if (above) splitters_.push_back(sample_pool_[high_index]);
+    }
+
+    // Leader, after a round's histogram: is the largest bucket over (1 + ε) n/p? The imbalance
+    // shrinks with 1/√s, so a miss multiplies the oversampling by the square of the observed
+    // over the target imbalance (at least doubling it, up to the n/p² cap of
+    // oversampling_ratio) and clears the round's samples and splitters
+    bool needs_refinement(int round) {
+        if (round >= options_.max_splitter_rounds || size_ == 0) return false;
+        size_t largest = 0;
+        for (int bucket = 0; bucket < num_workers_; ++bucket) {
+            largest = std::max(largest, bucket_end(bucket) - bucket_offset(bucket));
+        }
+        const double epsilon = std::max(options_.max_imbalance, 1e-3);
+        const double imbalance = largest * num_workers_ / static_cast<double>(size_) - 1;
+        if (imbalance <= epsilon) return false;
+        const size_t cap = std::max<size_t>(1, size_ / (static_cast<size_t>(num_workers_) * num_workers_));
+        const double growth = std::max(2.0, (imbalance / epsilon) * (imbalance / epsilon));
+        const size_t next = std::min(static_cast<size_t>(std::ceil(oversampling_ * growth)), cap);
+        if (next <= oversampling_) return false;
+        debug_print("Round " + std::to_string(round) + " imbalance " + std::to_string(imbalance) +
+                    " exceeds ε, resampling with " + std::to_string(next) + " samples per bucket");
+        oversampling_ = next;
+        sample_pool_.clear();
+        splitters_.clear();
+        return true;
+    }
+
+    // Elements per block of the in-place exchange
+    static constexpr size_t block_size() { return std::max<size_t>(1, BLOCK_BYTES / sizeof(Key)); }
+
+    // First element of a worker's Phase 1 chunk (worker == num_workers_ gives the end). In
+    // place, chunks are whole blocks so that stripes line up with the block slots
+    size_t chunk_begin(int worker_id) const {
+        if (worker_id == num_workers_) return size_;
+        if (in_place()) return size_ / block_size() * worker_id / num_workers_ * block_size();
+        return worker_id * (size_ / num_workers_);
+    }
+
+    bool sample_less(const Sample<Key>& a, const Sample<Key>& b) const { return detail::sample_less(a, b, less_); }
+
+    // Phase 3: the chunk is sorted, so every bucket is a contiguous range of it. Bucket bounds
+    // come from one binary search per splitter under the (key, worker, position) order, which
+    // splits runs of equal keys between buckets by position
+    void compute_bucket_bounds(WorkerContext<Key>* ctx) {
+        ctx->bucket_bounds = ctx->arena.template allocate<size_t>(num_workers_ + 1);
+        detail::bucket_bounds(splitters_.data(), splitters_.size(), ctx->chunk, ctx->chunk_size, ctx->worker_id,
+                              num_workers_, less_, ctx->bucket_bounds);
+    }
+
+    // Output offset of a bucket: the elements of all lower buckets on every worker
+    size_t bucket_offset(int bucket) const {
+        size_t offset = 0;
+        for (const auto& source : contexts_) {
+            offset += source.bucket_bounds[bucket];
+        }
+        return offset;
+    }
+
+    size_t bucket_end(int bucket) const { return bucket + 1 < num_workers_ ? bucket_offset(bucket + 1) : kept_; }
+
+    // The bucket holds some of the output ranks the sort orders
+    bool in_range(int bucket) const {
+        return range_base_ + bucket_offset(bucket) < range_end_ && range_base_ + bucket_end(bucket) > range_begin_;
+    }
+
+    // Phase 3 (unstable): the published bucket counts fix where every piece goes, so each
+    // worker copies its bucket ranges straight to their final region of the output without
+    // locks: bucket b starts at bucket_offset(b) and sources follow each other in worker order.
+    // The input array is free once Phase 1 has copied it, so it doubles as the exchange buffer.
+    // The stable path copies nothing and Phase 4 reads the ranges in source-worker order.
+    // A partial sort leaves buckets outside its range where they are.
+    void exchange(WorkerContext<Key>* ctx) {
+        for (int bucket = 0; bucket < num_workers_; ++bucket) {
+            const size_t begin = ctx->bucket_bounds[bucket];
+            const size_t end = ctx->bucket_bounds[bucket + 1];
+            if (begin == end || !in_range(bucket)) continue;
+            size_t offset = range_base_ + bucket_offset(bucket);
+            for (int src = 0; src < ctx->worker_id; ++src) {
+                offset += contexts_[src].bucket_bounds[bucket + 1] - contexts_[src].bucket_bounds[bucket];
+            }
+            std::copy(ctx->chunk + begin, ctx->chunk + end, data_ + offset);
+        }
+    }
+
+    // Bucket between two splitters with equal keys holds only copies of that key and needs no
+    // sorting (the first and last buckets are open-ended and never qualify)
+    bool is_equality_bucket(int bucket) const {
+        if (bucket == 0 || bucket >= (int)splitters_.size()) return false;
+        const Key& lower = splitters_[bucket - 1].key;
+        const Key& upper = splitters_[bucket].key;
+        return !less_(lower, upper) && !less_(upper, lower);
+    }
+
+    // Phase 4: sort the bucket in place in its output region. A bucket across an end of a
+    // partial sort's range first selects the range's part with nth_element and sorts only that
+    void sort_bucket(WorkerContext<Key>* ctx) {
+        const int worker_id = ctx->worker_id;
+        const size_t begin = range_base_ + bucket_offset(worker_id);
+        ctx->bucket_size = range_base_ + bucket_end(worker_id) - begin;
+        const size_t first = std::max(begin, range_begin_);
+        const size_t last = std::min(begin + ctx->bucket_size, range_end_);
+        ctx->sorted_size = first < last ? last - first : 0;
+        ctx->equality_bucket = is_equality_bucket(worker_id);
+        if (ctx->equality_bucket || ctx->sorted_size == 0) return;
+        Key* const bucket = data_ + begin;
+        Key* const bucket_last = bucket + ctx->bucket_size;
+        if (first > begin) std::nth_element(bucket, data_ + first, bucket_last, less_);
+        if (data_ + last < bucket_last) std::nth_element(data_ + first, data_ + last, bucket_last, less_);
+        if (in_place()) {
+            in_place_sort(data_ + first, ctx->sorted_size, less_);
+        } else {
+            local_sort(data_ + first, ctx->sorted_size, ctx->scratch, less_);
+        }
+    }
+
+    // Phase 4 (stable): p-way merge of this bucket's sorted range from every worker straight
+    // into the output. The heap pops the smallest key and, among equal keys, the lowest source
+    // worker, so equal keys leave in input order
+    void merge_bucket_stable(WorkerContext<Key>* ctx) {
+        const int worker_id = ctx->worker_id;
+        const int total_workers = num_workers_;
+        const Key** cursor = ctx->arena.template allocate<const Key*>(total_workers);
+        const Key** end = ctx->arena.template allocate<const Key*>(total_workers);
+        size_t output_offset = range_base_;
+        size_t bucket_size = 0;
+        for (int src = 0; src < total_workers; ++src) {
+            const WorkerContext<Key>& source = contexts_[src];
+            output_offset += source.bucket_bounds[worker_id];
+            cursor[src] = source.chunk + source.bucket_bounds[worker_id];
+            end[src] = source.chunk + source.bucket_bounds[worker_id + 1];
+            bucket_size += end[src] - cursor[src];
+        }
+        ctx->bucket_size = bucket_size;
+        // Outside a partial sort's range nothing is written; a bucket across an end is merged whole
+        const size_t first = std::max(output_offset, range_begin_);
+        const size_t last = std::min(output_offset + bucket_size, range_end_);
+        ctx->sorted_size = first < last ? last - first : 0;
+        if (ctx->sorted_size == 0) {
+            ctx->equality_bucket = false;
+            return;
+        }
+
+        // All keys equal: concatenating the ranges in source-worker order is the stable result
+        ctx->equality_bucket = is_equality_bucket(worker_id);
+        if (ctx->equality_bucket) {
+            Key* out = data_ + output_offset;
+            for (int src = 0; src < total_workers; ++src) {
+                out = std::copy(cursor[src], end[src], out);
+            }
+            return;
+        }
+
+        // Min-heap of source workers ordered by (current key, worker)
+        auto after = [&](int a, int b) {
+            if (less_(*cursor[b], *cursor[a])) return true;
+            if (less_(*cursor[a], *cursor[b])) return false;
+            return a > b;
+        };
+        int* heap = ctx->arena.template allocate<int>(total_workers);
+        int heap_size = 0;
+        for (int src = 0; src < total_workers; ++src) {
+            if (cursor[src] != end[src]) heap[heap_size++] = src;
+        }
+        std::make_heap(heap, heap + heap_size, after);
+        Key* out = data_ + output_offset;
+        while (heap_size > 0) {
+            std::pop_heap(heap, heap + heap_size, after);
+            const int src = heap[heap_size - 1];
+            *out++ = *cursor[src]++;
+            if (cursor[src] == end[src]) {
+                heap_size--;
+            } else {
+                std::push_heap(heap, heap + heap_size, after);
+            }
+        }
+    }
+
+    // Phase 3 (in place): the exchange of the IPS4o in-place sample sort. The input is a grid of
+    // block slots of B elements; elements move in whole blocks within it, so the extra space is
+    // O(p * B) per worker plus one bucket tag per slot:
+    // 1. Each worker packs the whole blocks of its stripe's bucket pieces to the stripe front
+    //    and keeps the remainders (< B per bucket) in its block buffer.
+    // 2. Bucket b owns the slots from its output offset rounded up to a block, up to the next
+    //    bucket's. Its owner moves the full slots of the region to the front.
+    // 3. Workers take blocks from a region's read cursor and swap them along the write cursors
+    //    of their buckets until every region holds only its own blocks.
+    // 4. Each worker fills the head and tail of its bucket (the parts not covered by its blocks)
+    //    from every worker's remainders and from its last block's overflow into the next bucket.
+    void permute_blocks(WorkerContext<Key>* ctx) {
+        compact_stripe(ctx);
+        wait_barrier(ctx, Phase3, "Compaction barrier");
+        gather_region(ctx);
+        wait_barrier(ctx, Phase3, "Gather barrier");
+        move_blocks(ctx);
+        wait_barrier(ctx, Phase3, "Block move barrier");
+        save_overflow(ctx);
+        wait_barrier(ctx, Phase3, "Overflow barrier"); // Overflows are saved before heads are overwritten
+        fill_bucket(ctx);
+    }
+
+    // Slot k is data_[k * B, (k + 1) * B); a last slot running past the input lives in tail_block_
+    Key* slot_data(size_t slot) {
+        const size_t B = block_size();
+        return (slot + 1) * B <= size_ ? data_ + slot * B : tail_block_.data();
+    }
+
+    // First slot of a bucket's region: its output offset rounded up to a whole block
+    size_t region_begin(int bucket) const {
+        return (bucket_offset(bucket) + block_size() - 1) / block_size();
+    }
+
+    // Whole blocks of a bucket over all stripes
+    size_t bucket_blocks(int bucket) const {
+        size_t blocks = 0;
+        for (const auto& source : contexts_) blocks += source.full_blocks[bucket];
+        return blocks;
+    }
+
+    // After compaction every stripe starts with its packed blocks and the rest is free
+    bool packed_slot(size_t slot) const {
+        for (int src = num_workers_ - 1; src >= 0; --src) {
+            const WorkerContext<Key>& source = contexts_[src];
+            const size_t first = (source.chunk - data_) / block_size();
+            if (slot >= first) return slot < first + source.packed_blocks;
+        }
+        return false;
+    }
+
+    // Step 1: pack whole blocks of each bucket piece to the stripe front in bucket order
+    void compact_stripe(WorkerContext<Key>* ctx) {
+        const size_t B = block_size();
+        const int total_workers = num_workers_;
+        ctx->blocks.resize((total_workers + 3) * B);
+        ctx->full_blocks = ctx->arena.template allocate<size_t>(total_workers);
+        ctx->remainder_bounds = ctx->arena.template allocate<size_t>(total_workers + 1);
+        ctx->remainder_bounds[0] = 0;
+        Key* stripe = ctx->chunk;
+        const size_t first_slot = (ctx->chunk - data_) / B;
+        size_t packed = 0;
+        for (int bucket = 0; bucket < total_workers; ++bucket) {
+            const size_t begin = ctx->bucket_bounds[bucket];
+            const size_t end = ctx->bucket_bounds[bucket + 1];
+            const size_t whole = (end - begin) / B * B;
+            // Packing only moves data towards the front, and the remainder is saved before the
+            // next piece is packed over it
+            std::move(stripe + begin, stripe + begin + whole, stripe + packed);
+            std::copy(stripe + begin + whole, stripe + end, ctx->blocks.data() + ctx->remainder_bounds[bucket]);
+            std::fill(block_buckets_.begin() + first_slot + packed / B,
+                      block_buckets_.begin() + first_slot + (packed + whole) / B, bucket);
+            packed += whole;
+            ctx->full_blocks[bucket] = whole / B;
+            ctx->remainder_bounds[bucket + 1] = ctx->remainder_bounds[bucket] + (end - begin - whole);
+        }
+        ctx->packed_blocks = packed / B;
+    }
+
+    // Step 2: a region can span several stripes; move its full slots to the region front so
+    // the blocks still to be moved lie between the cursors
+    void gather_region(WorkerContext<Key>* ctx) {
+        const int bucket = ctx->worker_id;
+        const size_t B = block_size();
+        size_t low = region_begin(bucket);
+        size_t high = region_begin(bucket + 1);
+        BlockCursor& cursor = cursors_[bucket];
+        cursor.write = low;
+        while (true) {
+            while (low < high && packed_slot(low)) low++;
+            while (high > low && !packed_slot(high - 1)) high--;
+            if (low >= high) break;
+            std::copy(data_ + (high - 1) * B, data_ + high * B, data_ + low * B);
+            block_buckets_[low++] = block_buckets_[--high];
+        }
+        cursor.read = low;
+        cursor.reading = 0;
+    }
+
+    // Step 3: take blocks from every region, starting with this worker's, and carry each to
+    // the write cursor of its bucket; an unmoved block found there is swapped out and carried
+    // on, until a block lands in a free slot
+    void move_blocks(WorkerContext<Key>* ctx) {
+        const size_t B = block_size();
+        const int total_workers = num_workers_;
+        Key* held = ctx->blocks.data() + total_workers * B;
+        Key* spare = held + B;
+        for (int i = 0; i < total_workers; ++i) {
+            const int region = (ctx->worker_id + i) % total_workers;
+            BlockCursor& source = cursors_[region];
+            while (true) {
+                lock_mutex(ctx, Phase3, &source.lock, "Block cursor lock", region);
+                if (source.read <= source.write) {
+                    pthread_mutex_unlock(&source.lock);
+                    break;
+                }
+                const size_t taken = --source.read;
+                source.reading++;
+                pthread_mutex_unlock(&source.lock);
+                std::copy(data_ + taken * B, data_ + (taken + 1) * B, held);
+                int bucket = block_buckets_[taken];
+                lock_mutex(ctx, Phase3, &source.lock, "Block cursor lock", region);
+                source.reading--;
+                pthread_mutex_unlock(&source.lock);
+
+                while (true) {
+                    BlockCursor& target = cursors_[bucket];
+                    lock_mutex(ctx, Phase3, &target.lock, "Block cursor lock", bucket);
+                    const size_t slot = target.write++;
+                    const bool unmoved = slot < target.read;
+                    pthread_mutex_unlock(&target.lock);
+                    Key* destination = slot_data(slot);
+                    if (unmoved) {
+                        std::copy(destination, destination + B, spare);
+                        std::copy(held, held + B, destination);
+                        std::swap(held, spare);
+                        std::swap(bucket, block_buckets_[slot]);
+                        continue;
+                    }
+                    // A free slot may still be read by the worker that took its block
+                    wait_for_readers(ctx, target, bucket);
+                    std::copy(held, held + B, destination);
+                    block_buckets_[slot] = bucket;
+                    break;
+                }
+            }
+        }
+    }
+
+    void wait_for_readers(WorkerContext<Key>* ctx, BlockCursor& cursor, int bucket) {
+        while (true) {
+            lock_mutex(ctx, Phase3, &cursor.lock, "Block cursor lock", bucket);
+            const int reading = cursor.reading;
+            pthread_mutex_unlock(&cursor.lock);
+            if (reading == 0) return;
+            sched_yield();
+        }
+    }
+
+    // Step 4a: the bucket's last block may run past the bucket into the next one's head (or
+    // past the input into tail_block_); keep the overflowing part before that head is filled
+    void save_overflow(WorkerContext<Key>* ctx) {
+        const int bucket = ctx->worker_id;
+        const size_t B = block_size();
+        ctx->overflow_size = 0;
+        const size_t blocks = bucket_blocks(bucket);
+        if (blocks == 0) return;
+        const size_t last = region_begin(bucket) + blocks - 1;
+        const size_t inside = std::min(B, bucket_offset(bucket + 1) - last * B);
+        const Key* block = slot_data(last);
+        if (block != data_ + last * B) {
+            std::copy(block, block + inside, data_ + last * B);
+        }
+        ctx->overflow_size = B - inside;
+        std::copy(block + inside, block + B, ctx->blocks.data() + (num_workers_ + 2) * B);
+    }
+
+    // Step 4b: the bucket's elements outside its whole blocks are the remainders on every
+    // worker plus the overflow; they fill the head before the first block and the tail after
+    // the last one (order is irrelevant, Phase 4 sorts the bucket)
+    void fill_bucket(WorkerContext<Key>* ctx) {
+        const int bucket = ctx->worker_id;
+        const size_t B = block_size();
+        const size_t end = bucket_offset(bucket + 1);
+        const size_t covered_begin = region_begin(bucket) * B;
+        const size_t covered_end = covered_begin + bucket_blocks(bucket) * B;
+        Key* const head_end = data_ + std::min(covered_begin, end);
+        Key* const tail_begin = data_ + std::min(covered_end, end);
+        Key* out = data_ + bucket_offset(bucket);
+        auto append = [&](const Key* first, const Key* last) {
+            while (first != last) {
+                if (out == head_end) out = tail_begin;
+                const size_t room = (out < head_end ? head_end : data_ + end) - out;
+                const size_t count = std::min<size_t>(last - first, room);
+                out = std::copy(first, first + count, out);
+                first += count;
+            }
+        };
+        for (const auto& source : contexts_) {
+            const Key* remainders = source.blocks.data();
+            append(remainders + source.remainder_bounds[bucket], remainders + source.remainder_bounds[bucket + 1]);
+        }
+        const Key* overflow = ctx->blocks.data() + (num_workers_ + 2) * B;
+        append(overflow, overflow + ctx->overflow_size);
+    }
+
+    Options options_;
+    Less less_;
+    const int num_workers_;
+
+    // Current sort; vectors keep their capacity from one sort to the next
+    Key* data_ = nullptr;               // Input and output (and exchange buffer) of the current sort
+    size_t size_ = 0;                   // Number of elements in data_
+    size_t range_begin_ = 0;            // Output ranks [range_begin_, range_end_) to order
+    size_t range_end_ = 0;
+    size_t range_base_ = 0;             // Global rank of the smallest key kept by Phase 1
+    size_t kept_ = 0;                   // Keys kept by Phase 1 (size_ unless a partial sort dropped some)
+    size_t range_low_ = SIZE_MAX;       // Partial sort: samples bounding the kept keys (SIZE_MAX = none)
+    size_t range_high_ = SIZE_MAX;
+    bool range_fallback_ = false;       // The bounds missed the range and every key was kept
+    std::vector<Sample<Key>> sample_pool_; // Samples contributed by all workers in Phase 2a
+    std::vector<Sample<Key>> splitters_; // Selected partition boundaries
+    int splitter_rounds_ = 0;
+    size_t oversampling_ = 0;           // Samples per bucket (and per worker) of the current round
+    bool refine_ = false;               // Leader's decision to run another splitter round
+    uint32_t sorts_ = 0;                // Sorts run so far, numbering trace events
+    const Clock::time_point trace_epoch_ = Clock::now(); // Time zero of the trace
+    std::vector<WorkerContext<Key>> contexts_;
+    std::vector<int> block_buckets_;    // In place: bucket of the block in each slot
+    std::vector<Key> tail_block_;       // In place: block slot past the end of the input
+    std::vector<BlockCursor> cursors_;  // In place: block cursors per bucket region
+
+    // Synchronization
+    pthread_barrier_t barrier_;         // Between phases (workers only)
+    pthread_mutex_t lock_;              // Protects sample_pool_
+
+    // Thread pool
+    pthread_barrier_t start_barrier_;   // Releases the pool into a job (workers + caller)
+    pthread_barrier_t done_barrier_;    // Signals job completion (workers + caller)
+    std::vector<pthread_t> threads_;
+    std::vector<Launch> launches_;
+    Job job_ = {nullptr, nullptr};
+    bool shutdown_ = false;
+    double pool_startup_duration_ = 0.0;
+};
+
+// Wait for the child processes in pids and for no other child of the caller, which may have
+// children of its own. Reaped entries are set to -1. Returns false as soon as one of them
+// fails, with the others still running for the caller to stop; a child that is already gone
+// (SIGCHLD ignored by the caller) counts as finished. Children are watched through pidfds
+// (Linux 5.3), so a failure is seen while earlier children still run, and polled otherwise
+inline bool wait_children(std::vector<pid_t>& pids) {
+    std::vector<pollfd> fds(pids.size(), pollfd{-1, POLLIN, 0});
+    bool watched = true;
+    for (size_t i = 0; i < pids.size(); ++i) {
+        if (pids[i] <= 0) continue;
+#ifdef SYS_pidfd_open
+        fds[i].fd = static_cast<int>(syscall(SYS_pidfd_open, pids[i], 0));
+#endif
+        watched = watched && fds[i].fd >= 0;
+    }
+    auto close_fds = [&]() {
+        for (pollfd& fd : fds) {
+            if (fd.fd >= 0) ::close(fd.fd);
+            fd.fd = -1;
+        }
+    };
+    if (!watched) close_fds();
+
+    size_t running = std::count_if(pids.begin(), pids.end(), [](pid_t pid) { return pid > 0; });
+    while (running > 0) {
+        if (watched) {
+            if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) {
+                close_fds();
+                watched = false;
+            }
+        } else {
+            const timespec pause = {0, 100000};
+            nanosleep(&pause, nullptr);
+        }
+        for (size_t i = 0; i < pids.size(); ++i) {
+            if (pids[i] <= 0) continue;
+            int status = 0;
+            pid_t result;
+            do {
+                result = waitpid(pids[i], &status, WNOHANG);
+            } while (result < 0 && errno == EINTR);
+            if (result == 0) continue;
+            pids[i] = -1;
+            running--;
+            if (fds[i].fd >= 0) ::close(fds[i].fd);
+            fds[i].fd = -1;
+            if (result > 0 && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+                close_fds();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Results a worker process leaves in the shared segment of a ProcessSorter
+struct ProcessWorker {
+    int worker_id;
+    size_t chunk_size;                  // Elements sorted in Phase 1
+    size_t bucket_size;                 // Elements sorted in Phase 4
+    double phase1_duration;             // Same phases as WorkerContext, in seconds
+    double phase2a_duration;
+    double phase2b_duration;            // Leader only
+    double phase3_duration;
+    double phase4_duration;
+    std::array<uint64_t, PhaseCount> phase_page_faults; // Minor + major page faults of the process
+    std::array<SyncCounters, PhaseCount> phase_sync;    // Waits at the process-shared barrier and lock
+};
+
+// Multi-process sorter: every sort forks one process per worker, which runs the four phases on
+// a POSIX shared-memory segment holding the keys (input, exchange target and output), the
+// sample pool, the splitters, the bucket histograms and the workers' results. A process-shared
+// barrier and mutex replace the Sorter's. Chunks, radix scratch and all other allocations stay
+// private to each process, so workers share no allocator arenas and no page tables. One
+// splitter round (Options::oversampling applies, max_splitter_rounds does not); never stable
+// and never in place. Keys must be trivially copyable; the comparator, and a string arena it
+// points to, reach the workers through fork.
+template <typename Key, typename Less = KeyLess<Key>>
+class ProcessSorter {
+public:
+    static_assert(std::is_trivially_copyable_v<Key>, "keys are exchanged through shared memory");
+
+    explicit ProcessSorter(const Options& options = Options(), Less less = Less())
+        : options_(options), less_(std::move(less)), num_workers_(std::max(1, options.num_workers)) {}
+
+    ~ProcessSorter() { unmap_segment(); }
+
+    ProcessSorter(const ProcessSorter&) = delete;
+    ProcessSorter& operator=(const ProcessSorter&) = delete;
+
+    // Sort data[0, n): copy it into the segment, fork the workers, wait for them and copy the
+    // result back. Throws std::runtime_error if a worker cannot be started or fails
+    void sort(Key* data, size_t n) {
+        size_ = n;
+        oversampling_ = options_.oversampling > 0 ? options_.oversampling
+                                                  : oversampling_ratio(n, num_workers_, options_.max_imbalance);
+        const auto start_copy = Clock::now();
+        map_segment(n);
+        std::copy(data, data + n, keys_);
+        copy_duration_ = Duration(Clock::now() - start_copy).count();
+
+        // Buffered output would be written once by every process
+        std::cout.flush();
+        std::cerr.flush();
+        const auto start_fork = Clock::now();
+        std::vector<pid_t> pids;
+        for (int i = 0; i < num_workers_; ++i) {
+            const pid_t pid = fork();
+            if (pid < 0) {
+                stop_workers(pids);
+                throw std::runtime_error("hss::ProcessSorter: fork failed");
+            }
+            if (pid == 0) {
+                int status = 1;
+                try {
+                    pin_process(i);
+                    run_worker(i);
+                    status = 0;
+                } catch (...) {
+                }
+                _exit(status);
+            }
+            pids.push_back(pid);
+        }
+        fork_duration_ = Duration(Clock::now() - start_fork).count();
+
+        // A worker that dies leaves the others blocked at the barrier, so stop them all
+        if (!wait_children(pids)) {
+            stop_workers(pids);
+            throw std::runtime_error("hss::ProcessSorter: a worker process failed");
+        }
+
+        const auto start_copy_back = Clock::now();
+        std::copy(keys_, keys_ + n, data);
+        copy_duration_ += Duration(Clock::now() - start_copy_back).count();
+        workers_.assign(stats_, stats_ + num_workers_);
+    }
+
+    int num_workers() const { return num_workers_; }
+    const Options& options() const { return options_; }
+    // Per-worker results of the last sort
+    const std::vector<ProcessWorker>& workers() const { return workers_; }
+    // Time spent forking the worker processes in the last sort
+    double fork_duration() const { return fork_duration_; }
+    // Time spent copying the keys into the segment and back in the last sort
+    double copy_duration() const { return copy_duration_; }
+    // Samples per bucket in the last sort
+    size_t oversampling() const { return oversampling_; }
+    // Bytes of the shared-memory segment
+    size_t segment_bytes() const { return segment_bytes_; }
+
+private:
+    // Shared state at the start of the segment; the arrays follow it
+    struct Header {
+        pthread_barrier_t barrier;      // Between phases (workers only)
+        pthread_mutex_t lock;           // Protects the sample pool
+        size_t sample_count;            // Samples in the pool
+        size_t splitter_count;
+    };
+
+    static size_t align(size_t offset) { return (offset + 63) & ~size_t(63); }
+
+    // Size the segment for n keys, reusing the mapping when it is large enough, and lay out
+    // the arrays: worker results, histograms (p rows of p + 1 bounds), splitters, samples, keys
+    void map_segment(size_t n) {
+        const size_t p = num_workers_;
+        const size_t samples = p * std::max<size_t>(1, oversampling_);
+        const size_t stats_offset = align(sizeof(Header));
+        const size_t bounds_offset = align(stats_offset + p * sizeof(ProcessWorker));
+        const size_t splitters_offset = align(bounds_offset + p * (p + 1) * sizeof(size_t));
+        const size_t samples_offset = align(splitters_offset + p * sizeof(Sample<Key>));
+        const size_t keys_offset = align(samples_offset + samples * sizeof(Sample<Key>));
+        const size_t bytes = keys_offset + n * sizeof(Key);
+        if (bytes > segment_bytes_) {
+            unmap_segment();
+            // Named only until it is mapped: the mapping survives fork and the name cannot leak
+            const std::string name = "/hss-" + std::to_string(getpid()) + "-" +
+                                     std::to_string(reinterpret_cast<uintptr_t>(this));
+            const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd < 0) throw std::runtime_error("hss::ProcessSorter: shm_open failed");
+            shm_unlink(name.c_str());
+            void* mapped = MAP_FAILED;
+            if (ftruncate(fd, bytes) == 0) {
+                mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | (options_.populate ? MAP_POPULATE : 0), fd, 0);
+            }
+            ::close(fd);
+            if (mapped == MAP_FAILED) throw std::bad_alloc();
+            segment_ = static_cast<char*>(mapped);
+            segment_bytes_ = bytes;
+        } else {
+            destroy_sync();
+        }
+        header_ = reinterpret_cast<Header*>(segment_);
+        stats_ = reinterpret_cast<ProcessWorker*>(segment_ + stats_offset);
+        bounds_ = reinterpret_cast<size_t*>(segment_ + bounds_offset);
+        splitters_ = reinterpret_cast<Sample<Key>*>(segment_ + splitters_offset);
+        samples_ = reinterpret_cast<Sample<Key>*>(segment_ + samples_offset);
+        keys_ = reinterpret_cast<Key*>(segment_ + keys_offset);
+
+        pthread_barrierattr_t barrier_attr;
+        pthread_barrierattr_init(&barrier_attr);
+        pthread_barrierattr_setpshared(&barrier_attr, PTHREAD_PROCESS_SHARED);
+        pthread_barrier_init(&header_->barrier, &barrier_attr, num_workers_);
+        pthread_barrierattr_destroy(&barrier_attr);
+        pthread_mutexattr_t mutex_attr;
+        pthread_mutexattr_init(&mutex_attr);
+        pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutex_init(&header_->lock, &mutex_attr);
+        pthread_mutexattr_destroy(&mutex_attr);
+        header_->sample_count = 0;
+        header_->splitter_count = 0;
+        sync_ready_ = true;
+    }
+
+    void destroy_sync() {
+        if (!sync_ready_) return;
+        pthread_barrier_destroy(&header_->barrier);
+        pthread_mutex_destroy(&header_->lock);
+        sync_ready_ = false;
+    }
+
+    void unmap_segment() {
+        if (segment_ == nullptr) return;
+        destroy_sync();
+        munmap(segment_, segment_bytes_);
+        segment_ = nullptr;
+        segment_bytes_ = 0;
+    }
+
+    static void stop_workers(const std::vector<pid_t>& pids) {
+        for (pid_t pid : pids) {
+            if (pid > 0) kill(pid, SIGKILL);
+        }
+        for (pid_t pid : pids) {
+            if (pid > 0) waitpid(pid, nullptr, 0);
+        }
+    }
+
+    void pin_process(int worker_id) const {
+#ifdef __linux__
+        if (options_.cpu_affinity.empty()) return;
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options_.cpu_affinity[worker_id % options_.cpu_affinity.size()], &cpus);
+        sched_setaffinity(0, sizeof(cpus), &cpus);
+#else
+        (void)worker_id;
+#endif
+    }
+
+    static uint64_t page_faults() {
+        rusage self;
+        return getrusage(RUSAGE_SELF, &self) == 0 ? self.ru_minflt + self.ru_majflt : 0;
+    }
+
+    static uint64_t nanoseconds(Clock::duration duration) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+
+    void wait_barrier(ProcessWorker* stats, Phase phase) {
+        const auto begin = Clock::now();
+        pthread_barrier_wait(&header_->barrier);
+        stats->phase_sync[phase].barrier_waits++;
+        stats->phase_sync[phase].barrier_wait_ns += nanoseconds(Clock::now() - begin);
+    }
+
+    bool sample_less(const Sample<Key>& a, const Sample<Key>& b) const { return detail::sample_less(a, b, less_); }
+
+    // Output offset of a bucket from the published histograms
+    size_t bucket_offset(int bucket) const {
+        size_t offset = 0;
+        for (int src = 0; src < num_workers_; ++src) offset += bounds_[src * (num_workers_ + 1) + bucket];
+        return offset;
+    }
+
+    // One worker process: the phases of Sorter::run_worker without refinement, stability or the
+    // in-place exchange; the results go to the worker's slot in the segment
+    void run_worker(int worker_id) {
+        const int total_workers = num_workers_;
+        ProcessWorker* stats = stats_ + worker_id;
+        *stats = ProcessWorker();
+        stats->worker_id = worker_id;
+        uint64_t faults = page_faults();
+        auto end_phase = [&](Phase phase) {
+            const uint64_t now = page_faults();
+            stats->phase_page_faults[phase] = now - faults;
+            faults = now;
+        };
+
+        // Phase 1: copy and sort this worker's chunk in private memory
+        auto start_phase1 = Clock::now();
+        const size_t chunk_start = worker_id * (size_ / total_workers);
+        const size_t chunk_end = worker_id + 1 < total_workers ? chunk_start + size_ / total_workers : size_;
+        const BufferAllocator<Key> allocator(options_.huge_pages, options_.populate);
+        Buffer<Key> chunk(keys_ + chunk_start, keys_ + chunk_end, allocator);
+        Buffer<Key> scratch(allocator);
+        local_sort(chunk, scratch, less_);
+        stats->chunk_size = chunk.size();
+        stats->phase1_duration = Duration(Clock::now() - start_phase1).count();
+        end_phase(Phase1);
+        wait_barrier(stats, Phase1);
+
+        // Phase 2a: selection sampling over the sorted chunk into the shared pool
+        auto start_phase2a = Clock::now();
+        std::vector<Sample<Key>> local_samples;
+        std::mt19937 rng(options_.random_seed + worker_id);
+        const size_t chunk_size = chunk.size();
+        size_t needed = std::min(oversampling_, chunk_size);
+        for (size_t i = 0; i < chunk_size && needed > 0; ++i) {
+            if (std::uniform_int_distribution<size_t>(0, chunk_size - i - 1)(rng) < needed) {
+                local_samples.push_back({chunk[i], worker_id, i});
+                needed--;
+            }
+        }
+        SyncCounters& pool_sync = stats->phase_sync[Phase2a];
+        pool_sync.lock_acquisitions++;
+        if (pthread_mutex_trylock(&header_->lock) != 0) {
+            const auto begin = Clock::now();
+            pthread_mutex_lock(&header_->lock);
+            pool_sync.contended_acquisitions++;
+            pool_sync.lock_wait_ns += nanoseconds(Clock::now() - begin);
+        }
+        std::copy(local_samples.begin(), local_samples.end(), samples_ + header_->sample_count);
+        header_->sample_count += local_samples.size();
+        pthread_mutex_unlock(&header_->lock);
+        stats->phase2a_duration = Duration(Clock::now() - start_phase2a).count();
+        end_phase(Phase2a);
+        wait_barrier(stats, Phase2a);
+
+        // Phase 2b: the leader picks the splitters
+        auto start_phase2b = Clock::now();
+        if (worker_id == 0) {
+            const size_t total_samples = header_->sample_count;
+            std::sort(samples_, samples_ + total_samples, [this](const Sample<Key>& a, const Sample<Key>& b) {
+                return sample_less(a, b);
+            });
+            header_->splitter_count = 0;
+            if (total_samples > 0) {
+                for (int i = 1; i < total_workers; ++i) {
+                    splitters_[header_->splitter_count++] = samples_[i * total_samples / total_workers];
+                }
+            }
+            stats->phase2b_duration = Duration(Clock::now() - start_phase2b).count();
+        }
+        end_phase(Phase2b);
+        wait_barrier(stats, Phase2b);
+
+        // Phase 3: publish this chunk's bucket bounds (tie-broken like Sorter), then copy every
+        // piece to its place in the shared keys
+        auto start_phase3 = Clock::now();
+        size_t* bounds = bounds_ + worker_id * (total_workers + 1);
+        detail::bucket_bounds(splitters_, header_->splitter_count, chunk.data(), chunk_size, worker_id, total_workers,
+                              less_, bounds);
+        wait_barrier(stats, Phase3);
+        for (int bucket = 0; bucket < total_workers; ++bucket) {
+            if (bounds[bucket] == bounds[bucket + 1]) continue;
+            size_t offset = bucket_offset(bucket);
+            for (int src = 0; src < worker_id; ++src) {
+                const size_t* source = bounds_ + src * (total_workers + 1);
+                offset += source[bucket + 1] - source[bucket];
+            }
+            std::copy(chunk.begin() + bounds[bucket], chunk.begin() + bounds[bucket + 1], keys_ + offset);
+        }
+        stats->phase3_duration = Duration(Clock::now() - start_phase3).count();
+        end_phase(Phase3);
+        wait_barrier(stats, Phase3);
+
+        // Phase 4: sort this worker's bucket where it landed
+        auto start_phase4 = Clock::now();
+        const size_t begin = bucket_offset(worker_id);
+        const size_t end = worker_id + 1 < total_workers ? bucket_offset(worker_id + 1) : size_;
+        stats->bucket_size = end - begin;
+        local_sort(keys_ + begin, end - begin, scratch, less_);
+        stats->phase4_duration = Duration(Clock::now() - start_phase4).count();
+        end_phase(Phase4);
+    }
+
+    Options options_;
+    Less less_;
+    const int num_workers_;
+    size_t size_ = 0;
+    size_t oversampling_ = 0;
+
+    // Shared-memory segment and its layout
+    char* segment_ = nullptr;
+    size_t segment_bytes_ = 0;
+    bool sync_ready_ = false;           // Barrier and mutex are initialized
+    Header* header_ = nullptr;
+    ProcessWorker* stats_ = nullptr;
+    size_t* bounds_ = nullptr;
+    Sample<Key>* splitters_ = nullptr;
+    Sample<Key>* samples_ = nullptr;
+    Key* keys_ = nullptr;
+
+    std::vector<ProcessWorker> workers_;
+    double fork_duration_ = 0.0;
+    double copy_duration_ = 0.0;
+};
+
+// Message passing between the ranks of a DistributedSorter: point-to-point byte transfers
+// between ranks 0..size()-1 and the collectives the sort needs. The collectives are built on
+// send_recv() in p - 1 shifted steps (rank r sends to r + d and receives from r - d) unless a
+// backend has native ones. Every rank calls a collective in the same order with sizes that
+// match between sender and receiver. Failures throw std::runtime_error
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+    virtual void send(int dest, const void* data, size_t bytes) = 0;
+    virtual void recv(int source, void* data, size_t bytes) = 0;
+    // Send to dest while receiving from source (both other ranks), so that a cycle of ranks
+    // sending to each other cannot deadlock on full buffers
+    virtual void send_recv(int dest, const void* send_data, size_t send_bytes,
+                           int source, void* recv_data, size_t recv_bytes) = 0;
+
+    // Return once every rank has called barrier()
+    virtual void barrier() {
+        char token = 0, ignored = 0;
+        for (int step = 1; step < size(); ++step) {
+            send_recv(step_dest(step), &token, 1, step_source(step), &ignored, 1);
+        }
+    }
+
+    // values[0, count) becomes the element-wise sum over all ranks, on every rank
+    virtual void all_reduce_sum(uint64_t* values, size_t count) {
+        const std::vector<uint64_t> own(values, values + count);
+        std::vector<uint64_t> other(count);
+        for (int step = 1; step < size(); ++step) {
+            send_recv(step_dest(step), own.data(), count * sizeof(uint64_t),
+                      step_source(step), other.data(), count * sizeof(uint64_t));
+            for (size_t i = 0; i < count; ++i) values[i] += other[i];
+        }
+    }
+
+    // Send send_bytes[r] bytes at send_data + send_offsets[r] to every rank r, and receive
+    // recv_bytes[r] bytes from rank r at recv_data + recv_offsets[r]. Receive sizes must be
+    // known beforehand, e.g. from an all_to_all_v of the counts
+    virtual void all_to_all_v(const void* send_data, const size_t* send_bytes, const size_t* send_offsets,
+                              void* recv_data, const size_t* recv_bytes, const size_t* recv_offsets) {
+        const char* out = static_cast<const char*>(send_data);
+        char* in = static_cast<char*>(recv_data);
+        const int self = rank();
+        std::memcpy(in + recv_offsets[self], out + send_offsets[self], std::min(send_bytes[self], recv_bytes[self]));
+        for (int step = 1; step < size(); ++step) {
+            const int dest = step_dest(step), source = step_source(step);
+            send_recv(dest, out + send_offsets[dest], send_bytes[dest],
+                      source, in + recv_offsets[source], recv_bytes[source]);
+        }
+    }
+
+    // Every rank contributes bytes bytes; out receives size() * bytes, in rank order
+    void all_gather(const void* data, size_t bytes, void* out) {
+        const std::vector<size_t> sizes(size(), bytes), same(size(), 0);
+        std::vector<size_t> offsets(size());
+        for (int r = 0; r < size(); ++r) offsets[r] = r * bytes;
+        all_to_all_v(data, sizes.data(), same.data(), out, sizes.data(), offsets.data());
+    }
+
+    // Every rank contributes a vector of any length; out receives all of them in rank order
+    template <typename T>
+    void all_gather_v(const std::vector<T>& data, std::vector<T>& out) {
+        static_assert(std::is_trivially_copyable_v<T>, "gathered values are copied as bytes");
+        const int p = size();
+        const size_t bytes = data.size() * sizeof(T);
+        std::vector<size_t> recv_bytes(p), recv_offsets(p);
+        all_gather(&bytes, sizeof(bytes), recv_bytes.data());
+        size_t total = 0;
+        for (int r = 0; r < p; ++r) {
+            recv_offsets[r] = total;
+            total += recv_bytes[r];
+        }
+        out.resize(total / sizeof(T));
+        const std::vector<size_t> send_bytes(p, bytes), send_offsets(p, 0);
+        all_to_all_v(data.data(), send_bytes.data(), send_offsets.data(),
+                     out.data(), recv_bytes.data(), recv_offsets.data());
+    }
+
+protected:
+    int step_dest(int step) const { return (rank() + step) % size(); }
+    int step_source(int step) const { return (rank() - step + size()) % size(); }
+};
+
+// Loopback backend: a stream socket to every other rank (Unix-domain sockets between processes
+// on one machine, see run_local_ranks). The transport owns and closes the sockets
+class SocketTransport : public Transport {
+public:
+    // peers[r] is connected to rank r; peers[rank] is unused (-1)
+    SocketTransport(int rank, std::vector<int> peers) : rank_(rank), peers_(std::move(peers)) {}
+
+    ~SocketTransport() override {
+        for (int fd : peers_) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    SocketTransport(const SocketTransport&) = delete;
+    SocketTransport& operator=(const SocketTransport&) = delete;
+
+    int rank() const override { return rank_; }
+    int size() const override { return static_cast<int>(peers_.size()); }
+
+    void send(int dest, const void* data, size_t bytes) override {
+        const char* next = static_cast<const char*>(data);
+        while (bytes > 0) {
+            const ssize_t sent = ::send(peers_[dest], next, bytes, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) throw std::runtime_error("hss::SocketTransport: send failed");
+            next += sent;
+            bytes -= sent;
+        }
+    }
+
+    void recv(int source, void* data, size_t bytes) override {
+        char* next = static_cast<char*>(data);
+        while (bytes > 0) {
+            const ssize_t received = ::recv(peers_[source], next, bytes, 0);
+            if (received < 0 && errno == EINTR) continue;
+            if (received <= 0) throw std::runtime_error("hss::SocketTransport: peer closed or recv failed");
+            next += received;
+            bytes -= received;
+        }
+    }
+
+    // Non-blocking transfers in both directions driven by poll(), so both peers make progress
+    // however small the socket buffers are
+    void send_recv(int dest, const void* send_data, size_t send_bytes,
+                   int source, void* recv_data, size_t recv_bytes) override {
+        const char* out = static_cast<const char*>(send_data);
+        char* in = static_cast<char*>(recv_data);
+        while (send_bytes > 0 || recv_bytes > 0) {
+            pollfd fds[2];
+            int count = 0;
+            if (send_bytes > 0) fds[count++] = {peers_[dest], POLLOUT, 0};
+            if (recv_bytes > 0) fds[count++] = {peers_[source], POLLIN, 0};
+            if (poll(fds, count, -1) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("hss::SocketTransport: poll failed");
+            }
+            for (int i = 0; i < count; ++i) {
+                if (fds[i].revents == 0) continue;
+                if (fds[i].events == POLLOUT) {
+                    const ssize_t sent = ::send(fds[i].fd, out, send_bytes, MSG_DONTWAIT | MSG_NOSIGNAL);
+                    if (sent > 0) {
+                        out += sent;
+                        send_bytes -= sent;
+                    } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                        throw std::runtime_error("hss::SocketTransport: send failed");
+                    }
+                } else {
+                    const ssize_t received = ::recv(fds[i].fd, in, recv_bytes, MSG_DONTWAIT);
+                    if (received > 0) {
+                        in += received;
+                        recv_bytes -= received;
+                    } else if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                        throw std::runtime_error("hss::SocketTransport: peer closed or recv failed");
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    int rank_;
+    std::vector<int> peers_;
+};
+
+// Fork `ranks` processes, connect every pair with a Unix-domain socket and call
+// fn(SocketTransport&) in each; fn returns true on success. The caller only waits, and gets
+// true if every rank succeeded. A rank that fails or dies closes its sockets, so its peers
+// fail at their next transfer instead of waiting forever. Linux uses abstract socket names;
+// elsewhere the listening sockets are files in /tmp that are removed once all ranks connected
+template <typename Fn>
+bool run_local_ranks(int ranks, Fn&& fn) {
+    ranks = std::max(1, ranks);
+    const pid_t parent = getpid();
+    auto address = [parent](int rank) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        const std::string name = "hss-" + std::to_string(parent) + "-" + std::to_string(rank);
+#ifdef __linux__
+        std::memcpy(addr.sun_path + 1, name.data(), std::min(name.size(), sizeof(addr.sun_path) - 2));
+#else
+        const std::string path = "/tmp/" + name + ".sock";
+        std::memcpy(addr.sun_path, path.data(), std::min(path.size(), sizeof(addr.sun_path) - 1));
+#endif
+        return addr;
+    };
+    auto remove_names = [&]() {
+#ifndef __linux__
+        for (int r = 0; r < ranks; ++r) unlink(address(r).sun_path);
+#endif
+    };
+
+    // Rank r accepts a connection from every higher rank on listeners[r]; the backlog holds
+    // them until it gets there, so connecting never waits for the peer
+    std::vector<int> listeners(ranks, -1);
+    auto close_listeners = [&]() {
+        for (int& fd : listeners) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+    };
+    for (int r = 0; r < ranks; ++r) {
+        const sockaddr_un addr = address(r);
+        listeners[r] = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listeners[r] < 0 || bind(listeners[r], reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listeners[r], ranks) != 0) {
+            close_listeners();
+            remove_names();
+            throw std::runtime_error("hss::run_local_ranks: cannot create a listening socket");
+        }
+    }
+
+    // Buffered output would be written once by every process
+    std::cout.flush();
+    std::cerr.flush();
+    std::vector<pid_t> pids;
+    for (int r = 0; r < ranks; ++r) {
+        const pid_t pid = fork();
+        if (pid < 0) break;
+        if (pid == 0) {
+            int status = 1;
+            try {
+                const int own = listeners[r];
+                listeners[r] = -1;
+                close_listeners();
+                std::vector<int> peers(ranks, -1);
+                for (int peer = 0; peer < r; ++peer) {
+                    const sockaddr_un addr = address(peer);
+                    peers[peer] = socket(AF_UNIX, SOCK_STREAM, 0);
+                    if (peers[peer] < 0 ||
+                        connect(peers[peer], reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                        ::send(peers[peer], &r, sizeof(r), MSG_NOSIGNAL) != sizeof(r)) {
+                        throw std::runtime_error("hss::run_local_ranks: connect failed");
+                    }
+                }
+                for (int accepted = r + 1; accepted < ranks; ++accepted) {
+                    const int fd = accept(own, nullptr, nullptr);
+                    int peer = -1;
+                    if (fd < 0 || ::recv(fd, &peer, sizeof(peer), MSG_WAITALL) != sizeof(peer) || peer <= r ||
+                        peer >= ranks || peers[peer] >= 0) {
+                        throw std::runtime_error("hss::run_local_ranks: accept failed");
+                    }
+                    peers[peer] = fd;
+                }
+                ::close(own);
+                SocketTransport transport(r, std::move(peers));
+                status = fn(static_cast<Transport&>(transport)) ? 0 : 1;
+            } catch (const std::exception& error) {
+                std::cerr << error.what() << "\n";
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            _exit(status);
+        }
+        pids.push_back(pid);
+    }
+    close_listeners();
+
+    // A rank that fails before connecting leaves its peers waiting in accept(), so stop them all
+    const bool success = static_cast<int>(pids.size()) == ranks && wait_children(pids);
+    if (!success) {
+        for (pid_t pid : pids) {
+            if (pid > 0) kill(pid, SIGKILL);
+        }
+        for (pid_t pid : pids) {
+            while (pid > 0 && waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+            }
+        }
+    }
+    remove_names();
+    return success;
+}
+
+#ifdef HSS_MPI
+// MPI backend over MPI_COMM_WORLD. MPI is initialized on construction unless the application
+// did it already, and only then finalized on destruction. Transfers above MAX_MESSAGE bytes
+// are split, since MPI counts are ints
+class MpiTransport : public Transport {
+public:
+    MpiTransport() {
+        int initialized = 0;
+        MPI_Initialized(&initialized);
+        if (!initialized) {
+            MPI_Init(nullptr, nullptr);
+            owns_mpi_ = true;
+        }
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+        MPI_Comm_size(MPI_COMM_WORLD, &size_);
+    }
+
+    ~MpiTransport() override {
+        if (owns_mpi_) MPI_Finalize();
+    }
+
+    MpiTransport(const MpiTransport&) = delete;
+    MpiTransport& operator=(const MpiTransport&) = delete;
+
+    int rank() const override { return rank_; }
+    int size() const override { return size_; }
+
+    void send(int dest, const void* data, size_t bytes) override {
+        const char* next = static_cast<const char*>(data);
+        for (size_t done = 0; done < bytes; done += MAX_MESSAGE) {
+            const int count = static_cast<int>(std::min(MAX_MESSAGE, bytes - done));
+            check(MPI_Send(next + done, count, MPI_BYTE, dest, 0, MPI_COMM_WORLD));
+        }
+    }
+
+    void recv(int source, void* data, size_t bytes) override {
+        char* next = static_cast<char*>(data);
+        for (size_t done = 0; done < bytes; done += MAX_MESSAGE) {
+            const int count = static_cast<int>(std::min(MAX_MESSAGE, bytes - done));
+            check(MPI_Recv(next + done, count, MPI_BYTE, source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE));
+        }
+    }
+
+    void send_recv(int dest, const void* send_data, size_t send_bytes,
+                   int source, void* recv_data, size_t recv_bytes) override {
+        std::vector<MPI_Request> requests;
+        char* in = static_cast<char*>(recv_data);
+        for (size_t done = 0; done < recv_bytes; done += MAX_MESSAGE) {
+            requests.emplace_back();
+            check(MPI_Irecv(in + done, static_cast<int>(std::min(MAX_MESSAGE, recv_bytes - done)), MPI_BYTE,
+                            source, 0, MPI_COMM_WORLD, &requests.back()));
+        }
+        const char* out = static_cast<const char*>(send_data);
+        for (size_t done = 0; done < send_bytes; done += MAX_MESSAGE) {
+            requests.emplace_back();
+            check(MPI_Isend(out + done, static_cast<int>(std::min(MAX_MESSAGE, send_bytes - done)), MPI_BYTE,
+                            dest, 0, MPI_COMM_WORLD, &requests.back()));
+        }
+        check(MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE));
+    }
+
+    void barrier() override { check(MPI_Barrier(MPI_COMM_WORLD)); }
+
+    void all_reduce_sum(uint64_t* values, size_t count) override {
+        const size_t max_values = MAX_MESSAGE / sizeof(uint64_t);
+        for (size_t done = 0; done < count; done += max_values) {
+            check(MPI_Allreduce(MPI_IN_PLACE, values + done, static_cast<int>(std::min(max_values, count - done)),
+                                MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD));
+        }
+    }
+
+    // MPI_Alltoallv when every size and offset fits its int arguments, the shifted steps otherwise
+    void all_to_all_v(const void* send_data, const size_t* send_bytes, const size_t* send_offsets,
+                      void* recv_data, const size_t* recv_bytes, const size_t* recv_offsets) override {
+        std::vector<int> counts(4 * size_);
+        bool fits = true;
+        for (int r = 0; r < size_; ++r) {
+            const size_t values[4] = {send_bytes[r], send_offsets[r], recv_bytes[r], recv_offsets[r]};
+            for (int i = 0; i < 4; ++i) {
+                fits = fits && values[i] <= MAX_MESSAGE;
+                counts[i * size_ + r] = static_cast<int>(std::min(values[i], MAX_MESSAGE));
+            }
+        }
+        if (!fits) {
+            Transport::all_to_all_v(send_data, send_bytes, send_offsets, recv_data, recv_bytes, recv_offsets);
+            return;
+        }
+        const int* sizes = counts.data();
+        check(MPI_Alltoallv(send_data, sizes, sizes + size_, MPI_BYTE,
+                            recv_data, sizes + 2 * size_, sizes + 3 * size_, MPI_BYTE, MPI_COMM_WORLD));
+    }
+
+private:
+    static constexpr size_t MAX_MESSAGE = size_t(1) << 30;
+
+    static void check(int result) {
+        if (result != MPI_SUCCESS) throw std::runtime_error("hss::MpiTransport: MPI call failed");
+    }
+
+    int rank_ = 0;
+    int size_ = 1;
+    bool owns_mpi_ = false;
+};
+#endif
+
+// Ranks [first, first + size) of a parent transport as a transport of their own, for the lower
+// levels of a hierarchical DistributedSorter. Transfers go through the parent with translated
+// ranks; the collectives are the Transport defaults over them
+class GroupTransport : public Transport {
+public:
+    GroupTransport(Transport& parent, int first, int size) : parent_(parent), first_(first), size_(size) {}
+
+    int rank() const override { return parent_.rank() - first_; }
+    int size() const override { return size_; }
+    void send(int dest, const void* data, size_t bytes) override { parent_.send(first_ + dest, data, bytes); }
+    void recv(int source, void* data, size_t bytes) override { parent_.recv(first_ + source, data, bytes); }
+    void send_recv(int dest, const void* send_data, size_t send_bytes,
+                   int source, void* recv_data, size_t recv_bytes) override {
+        parent_.send_recv(first_ + dest, send_data, send_bytes, first_ + source, recv_data, recv_bytes);
+    }
+
+private:
+    Transport& parent_;
+    int first_;
+    int size_;
+};
+
+// Groups of consecutive ranks at the top of a sort over p ranks in `levels` levels: about
+// p^(1/levels), or p (one rank per bucket, a flat level) when that leaves fewer than 2 groups
+inline int rank_groups(int p, int levels) {
+    if (levels <= 1) return p;
+    const int groups = static_cast<int>(std::lround(std::pow(static_cast<double>(p), 1.0 / levels)));
+    return groups < 2 ? p : std::min(groups, p);
+}
+
+// First rank of a group when p ranks form `groups` groups of consecutive ranks
+inline int group_begin(int group, int p, int groups) {
+    return static_cast<int>(static_cast<int64_t>(group) * p / groups);
+}
+
+// Results of one rank of a DistributedSorter
+struct DistributedStats {
+    int rank;
+    size_t input_size;                  // Keys the rank held before the sort
+    size_t bucket_size;                 // Keys it holds afterwards
+    // Phase times, summed over the levels of a hierarchical sort
+    double phase1_duration;             // Local sort
+    double phase2a_duration;            // Sampling inside the open intervals and gathering the samples
+    double phase2b_duration;            // Histogram of the samples (all-reduce) and interval updates
+    double phase3_duration;             // All-to-all exchange of the buckets
+    double phase4_duration;             // Sort of the received pieces
+    int levels;                         // Levels the rank took part in
+    int rounds;                         // Histogramming rounds over all levels
+    size_t samples;                     // Distinct samples gathered over all rounds (same within a group)
+    uint64_t pieces_sent;               // Non-empty pieces sent to other ranks in Phase 3
+    uint64_t key_bytes_sent;            // Bytes of the keys in those pieces
+    uint64_t bytes_sent;                // Bytes sent for them: key_bytes_sent, or less when compressed
+    uint64_t bytes_received;
+    double encode_duration;             // Part of Phase 3 spent encoding (Options::compress_exchange)
+    double decode_duration;             // Part of Phase 3 spent decoding
+};
+
+// Histogramming rounds run until every splitter is within its tolerance; this bounds them when
+// Options::max_splitter_rounds is left at 1
+constexpr int HISTOGRAM_MAX_ROUNDS = 16;
+
+// Samples per splitter per histogramming round: ⌈2/ε⌉ puts the expected gap between samples
+// around a splitter's target at about half its ±ε N/(2p) tolerance, so most splitters are
+// settled in the first round and the rest in the next
+inline size_t histogram_sample_ratio(double epsilon) {
+    return std::max<size_t>(2, static_cast<size_t>(std::ceil(2 / std::max(epsilon, 1e-3))));
+}
+
+// Compressed format of the distributed Phase 3 (Options::compress_exchange) for integer and
+// floating-point keys. A piece is a sorted run, so the differences between the KeyTraits bits
+// of neighbours are small: the first key's bits are stored whole, then every block of BLOCK
+// differences as one byte of bit width w and the differences packed at w bits (frame of
+// reference), ⌈count w / 8⌉ bytes. Differences wrap, so any run decodes exactly; unsorted input
+// only packs worse. The difference and width passes are branch-free loops over a fixed block
+// that the compiler vectorizes; the packing itself goes through a 128-bit bit buffer. Words are
+// in host byte order, so all ranks must share it
+template <typename Key>
+struct DeltaCodec {
+    using Bits = typename KeyTraits<Key>::Bits;
+    static constexpr size_t BLOCK = 128;
+
+    // Upper bound of the encoded size of n keys
+    static size_t max_bytes(size_t n) { return n * sizeof(Bits) + (n / BLOCK + 1) + sizeof(Bits); }
+
+    // Encode keys[0, n) into out (at least max_bytes(n)); returns the bytes written
+    static size_t encode(const Key* keys, size_t n, unsigned char* out) {
+        if (n == 0) return 0;
+        Bits previous = KeyTraits<Key>::to_bits(keys[0]);
+        std::memcpy(out, &previous, sizeof(Bits));
+        size_t size = sizeof(Bits);
+        Bits deltas[BLOCK];
+        for (size_t begin = 1; begin < n; begin += BLOCK) {
+            const size_t count = std::min(BLOCK, n - begin);
+            Bits used = 0;
+            for (size_t i = 0; i < count; ++i) {
+                deltas[i] = KeyTraits<Key>::to_bits(keys[begin + i]) - KeyTraits<Key>::to_bits(keys[begin + i - 1]);
+                used |= deltas[i];
+            }
+            const int width = used == 0 ? 0 : 64 - __builtin_clzll(static_cast<uint64_t>(used));
+            out[size++] = static_cast<unsigned char>(width);
+            unsigned __int128 buffer = 0;
+            int buffered = 0;
+            for (size_t i = 0; i < count && width > 0; ++i) {
+                buffer |= static_cast<unsigned __int128>(deltas[i]) << buffered;
+                buffered += width;
+                if (buffered >= 64) {
+                    const uint64_t word = static_cast<uint64_t>(buffer);
+                    std::memcpy(out + size, &word, sizeof(word));
+                    size += sizeof(word);
+                    buffer >>= 64;
+                    buffered -= 64;
+                }
+            }
+            const uint64_t word = static_cast<uint64_t>(buffer);
+            std::memcpy(out + size, &word, (buffered + 7) / 8);
+            size += (buffered + 7) / 8;
+        }
+        return size;
+    }
+
+    // Decode n keys written by encode() into keys[0, n)
+    static void decode(const unsigned char* in, size_t n, Key* keys) {
+        if (n == 0) return;
+        Bits previous;
+        std::memcpy(&previous, in, sizeof(Bits));
+        in += sizeof(Bits);
+        keys[0] = KeyTraits<Key>::from_bits(previous);
+        for (size_t begin = 1; begin < n; begin += BLOCK) {
+            const size_t count = std::min(BLOCK, n - begin);
+            const int width = *in++;
+            if (width == 0) {
+                std::fill(keys + begin, keys + begin + count, keys[begin - 1]);
+                continue;
+            }
+            const uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+            size_t remaining = (count * width + 7) / 8;
+            unsigned __int128 buffer = 0;
+            int buffered = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if (buffered < width) {
+                    uint64_t word = 0;
+                    const size_t bytes = std::min(sizeof(word), remaining);
+                    std::memcpy(&word, in, bytes);
+                    in += bytes;
+                    remaining -= bytes;
+                    buffer |= static_cast<unsigned __int128>(word) << buffered;
+                    buffered += 64;
+                }
+                previous += static_cast<Bits>(static_cast<uint64_t>(buffer) & mask);
+                buffer >>= width;
+                buffered -= width;
+                keys[begin + i] = KeyTraits<Key>::from_bits(previous);
+            }
+            in += remaining;
+        }
+    }
+};
+
+// Distributed-memory HSS: one sorter per rank of a Transport, each holding a part of the
+// input. Phase 1 sorts the local keys. Phase 2 replaces the sample gather of Sorter with
+// histogramming rounds: each open splitter has an interval of global ranks known to contain its
+// target i N/p; every rank samples its keys inside the open intervals, the samples are gathered
+// on all ranks, and one all-reduce of their local ranks (the histogram) gives their global
+// ranks. A sample within ε N/(2p) of a target settles that splitter, the others shrink their
+// interval to the samples around the target. Every rank sees the same samples and histogram, so
+// all of them take the same decisions without a leader. Phase 3 exchanges the buckets with one
+// all-to-all, and Phase 4 sorts the received pieces: rank r ends up with bucket r, so the ranks'
+// keys in rank order are the sorted input, with every bucket within (1 + ε) N/p. Ties are broken
+// by (key, rank, position) as in Sorter. Never stable; keys must be trivially copyable, and a
+// string arena must be identical on every rank.
+//
+// With Options::levels = 2 the top level splits the ranks into about √p groups instead of p
+// buckets, and each group then sorts its part as a flat level of its own (more levels recurse
+// the same way, each getting ε / levels). A flat sort sends up to p (p - 1) pieces and settles
+// p - 1 splitters; two levels send about 2 p √p pieces and settle √p - 1 splitters over all
+// ranks, then √p - 1 per group in parallel
+template <typename Key, typename Less = KeyLess<Key>>
+class DistributedSorter {
+public:
+    static_assert(std::is_trivially_copyable_v<Key>, "keys are exchanged as bytes");
+
+    DistributedSorter(Transport& transport, const Options& options = Options(), Less less = Less())
+        : transport_(transport), options_(options), less_(std::move(less)) {}
+
+    // Sort the keys of all ranks; collective, every rank calls it with its own keys
+    template <typename Alloc>
+    void sort(std::vector<Key, Alloc>& keys) {
+        stats_ = DistributedStats();
+        stats_.rank = transport_.rank();
+        stats_.input_size = keys.size();
+        std::vector<Key, Alloc> scratch(keys.get_allocator());
+        sort_level(transport_, keys, scratch, std::max(1, options_.levels));
+        stats_.bucket_size = keys.size();
+    }
+
+    // Collective validation: the fingerprint of all ranks' keys together
+    Fingerprint fingerprint(const Key* data, size_t n) {
+        Fingerprint own;
+        for (size_t i = 0; i < n; ++i) own.add(key_hash(data[i]));
+        std::vector<Fingerprint> parts(transport_.size());
+        transport_.all_gather(&own, sizeof(own), parts.data());
+        Fingerprint total;
+        for (const Fingerprint& part : parts) total.merge(part);
+        return total;
+    }
+
+    // Collective validation: true if the ranks' keys, concatenated in rank order, are in order.
+    // Each rank checks its own keys, then the first and last keys of the non-empty ranks are
+    // compared across the rank boundaries
+    bool is_sorted(const Key* data, size_t n) {
+        struct Edge {
+            Key first;
+            Key last;
+            uint64_t count;
+            uint64_t sorted;
+        };
+        Edge own = {};
+        own.count = n;
+        own.sorted = std::is_sorted(data, data + n, less_);
+        if (n > 0) {
+            own.first = data[0];
+            own.last = data[n - 1];
+        }
+        std::vector<Edge> edges(transport_.size());
+        transport_.all_gather(&own, sizeof(own), edges.data());
+        const Edge* previous = nullptr;
+        for (const Edge& edge : edges) {
+            if (!edge.sorted) return false;
+            if (edge.count == 0) continue;
+            if (previous != nullptr && less_(edge.first, previous->last)) return false;
+            previous = &edge;
+        }
+        return true;
+    }
+
+    // Collective: the results of every rank, in rank order
+    std::vector<DistributedStats> gather_stats() {
+        std::vector<DistributedStats> all(transport_.size());
+        transport_.all_gather(&stats_, sizeof(stats_), all.data());
+        return all;
+    }
+
+    Transport& transport() const { return transport_; }
+    const Options& options() const { return options_; }
+    // This rank's results of the last sort
+    const DistributedStats& stats() const { return stats_; }
+    // Splitters of the top level of the last sort (the same on every rank)
+    const std::vector<Sample<Key>>& splitters() const { return splitters_; }
+    // Global rank of every top-level splitter in the last sort, its ideal rank (i + 1) N/p in a
+    // flat sort or the first rank of group i + 1 times N/p, and the allowed distance between them
+    const std::vector<uint64_t>& splitter_ranks() const { return splitter_ranks_; }
+    const std::vector<uint64_t>& splitter_targets() const { return splitter_targets_; }
+    double splitter_tolerance() const { return splitter_tolerance_; }
+    // Total keys over all ranks in the last sort
+    uint64_t global_size() const { return global_size_; }
+    // Samples per splitter per round in the last sort (of its last level)
+    size_t oversampling() const { return oversampling_; }
+
+private:
+    // Interval of a splitter's candidates: elements with global ranks in [lo_rank, hi_rank),
+    // which are keys[lo_local, hi_local) on this rank
+    struct Interval {
+        uint64_t target;                // Ideal global rank of the bucket's end
+        uint64_t lo_rank, hi_rank;
+        size_t lo_local, hi_local;
+        bool settled;
+        bool has_best;
+        Sample<Key> best;               // Sample whose global rank is closest to the target so far
+        uint64_t best_rank;
+    };
+
+    // Ranks stand in for workers in the shared sample order and bucket bounds
+    bool sample_less(const Sample<Key>& a, const Sample<Key>& b) const { return detail::sample_less(a, b, less_); }
+
+    // One level over the ranks of a transport: the four phases with one bucket per group of
+    // ranks. Rank r sends its piece of group j to the rank of j with index r mod |j|, so it sends
+    // and receives about one piece per group; a group of several ranks then sorts what it
+    // received as the next level, over a GroupTransport
+    template <typename Alloc>
+    void sort_level(Transport& transport, std::vector<Key, Alloc>& keys, std::vector<Key, Alloc>& scratch, int levels) {
+        const int p = transport.size();
+        const int rank = transport.rank();
+        const int groups = rank_groups(p, levels);
+        stats_.levels++;
+
+        // Phase 1: local sort (below the top level, of the sorted pieces from the level above)
+        auto start_phase1 = Clock::now();
+        local_sort(keys, scratch, less_);
+        stats_.phase1_duration += Duration(Clock::now() - start_phase1).count();
+
+        // Phase 2: histogramming rounds
+        const std::vector<Sample<Key>> splitters = select_splitters(
+            transport, keys.data(), keys.size(), groups, options_.max_imbalance / std::max(1, options_.levels));
+
+        // Phase 3: the piece for group j is keys[bounds[j], bounds[j + 1]). Exchange the key and
+        // byte counts of every piece, then the pieces, encoded by DeltaCodec when compressing
+        auto start_phase3 = Clock::now();
+        std::vector<size_t> bounds(groups + 1);
+        detail::bucket_bounds(splitters.data(), splitters.size(), keys.data(), keys.size(), rank, groups, less_,
+                              bounds.data());
+        std::vector<size_t> send_keys(p, 0), key_offsets(p, 0);
+        int own_group = 0;
+        for (int group = 0; group < groups; ++group) {
+            const int first = group_begin(group, p, groups);
+            const int size = group_begin(group + 1, p, groups) - first;
+            if (rank >= first && rank < first + size) own_group = group;
+            const int dest = first + rank % size;
+            send_keys[dest] = bounds[group + 1] - bounds[group];
+            key_offsets[dest] = bounds[group];
+        }
+        std::vector<size_t> send_bytes(p), send_offsets(p), recv_bytes(p), recv_offsets(p);
+        const void* send_data = keys.data();
+        const bool compress = compress_exchange();
+        if (compress) {
+            auto start_encode = Clock::now();
+            encode_pieces(keys.data(), rank, send_keys, key_offsets, send_bytes, send_offsets);
+            send_data = encoded_.data();
+            stats_.encode_duration += Duration(Clock::now() - start_encode).count();
+        } else {
+            for (int r = 0; r < p; ++r) {
+                send_bytes[r] = send_keys[r] * sizeof(Key);
+                send_offsets[r] = key_offsets[r] * sizeof(Key);
+            }
+        }
+        std::vector<size_t> send_counts(2 * p), recv_counts(2 * p);
+        for (int r = 0; r < p; ++r) {
+            send_counts[2 * r] = send_keys[r];
+            send_counts[2 * r + 1] = send_bytes[r];
+        }
+        const std::vector<size_t> count_bytes(p, 2 * sizeof(size_t));
+        std::vector<size_t> count_offsets(p);
+        for (int r = 0; r < p; ++r) count_offsets[r] = r * 2 * sizeof(size_t);
+        transport.all_to_all_v(send_counts.data(), count_bytes.data(), count_offsets.data(),
+                               recv_counts.data(), count_bytes.data(), count_offsets.data());
+        std::vector<size_t> recv_key_offsets(p);
+        size_t received_keys = 0, received_bytes = 0;
+        for (int r = 0; r < p; ++r) {
+            recv_key_offsets[r] = received_keys;
+            received_keys += recv_counts[2 * r];
+            recv_bytes[r] = recv_counts[2 * r + 1];
+            recv_offsets[r] = received_bytes;
+            received_bytes += recv_bytes[r];
+            if (r != rank) {
+                stats_.pieces_sent += send_keys[r] > 0;
+                stats_.key_bytes_sent += send_keys[r] * sizeof(Key);
+                stats_.bytes_sent += send_bytes[r];
+                stats_.bytes_received += recv_bytes[r];
+            }
+        }
+        std::vector<Key, Alloc> bucket(received_keys, keys.get_allocator());
+        if (compress) {
+            incoming_.resize(received_bytes);
+            transport.all_to_all_v(send_data, send_bytes.data(), send_offsets.data(),
+                                   incoming_.data(), recv_bytes.data(), recv_offsets.data());
+            auto start_decode = Clock::now();
+            std::copy(keys.begin() + key_offsets[rank], keys.begin() + key_offsets[rank] + send_keys[rank],
+                      bucket.begin() + recv_key_offsets[rank]);
+            decode_pieces(bucket.data(), rank, recv_counts, recv_key_offsets, recv_offsets);
+            stats_.decode_duration += Duration(Clock::now() - start_decode).count();
+        } else {
+            transport.all_to_all_v(send_data, send_bytes.data(), send_offsets.data(),
+                                   bucket.data(), recv_bytes.data(), recv_offsets.data());
+        }
+        keys.swap(bucket);
+        stats_.phase3_duration += Duration(Clock::now() - start_phase3).count();
+
+        if (groups < p) {
+            const int first = group_begin(own_group, p, groups);
+            GroupTransport group(transport, first, group_begin(own_group + 1, p, groups) - first);
+            sort_level(group, keys, scratch, levels - 1);
+            return;
+        }
+
+        // Phase 4: sort the p sorted pieces of this rank's bucket
+        auto start_phase4 = Clock::now();
+        local_sort(keys, scratch, less_);
+        stats_.phase4_duration += Duration(Clock::now() - start_phase4).count();
+    }
+
+    // Options::compress_exchange applies to keys with KeyTraits::from_bits (integers and floats)
+    bool compress_exchange() const {
+        if constexpr (std::is_arithmetic_v<Key>) {
+            return options_.compress_exchange;
+        } else {
+            return false;
+        }
+    }
+
+    // Encode the pieces for the other ranks back to back into encoded_ and set their sizes and
+    // offsets there; this rank's own piece is copied unencoded
+    void encode_pieces(const Key* keys, int self, const std::vector<size_t>& piece_keys,
+                       const std::vector<size_t>& piece_offsets, std::vector<size_t>& bytes,
+                       std::vector<size_t>& offsets) {
+        if constexpr (std::is_arithmetic_v<Key>) {
+            size_t capacity = 0;
+            for (size_t r = 0; r < piece_keys.size(); ++r) capacity += DeltaCodec<Key>::max_bytes(piece_keys[r]);
+            if (encoded_.size() < capacity) encoded_.resize(capacity);
+            size_t size = 0;
+            for (size_t r = 0; r < piece_keys.size(); ++r) {
+                offsets[r] = size;
+                bytes[r] = (int)r == self ? 0
+                                          : DeltaCodec<Key>::encode(keys + piece_offsets[r], piece_keys[r],
+                                                                    encoded_.data() + size);
+                size += bytes[r];
+            }
+        }
+    }
+
+    // Decode the pieces received from the other ranks (key counts at even indexes of counts)
+    // from incoming_ into the bucket
+    void decode_pieces(Key* bucket, int self, const std::vector<size_t>& counts,
+                       const std::vector<size_t>& key_offsets, const std::vector<size_t>& byte_offsets) {
+        if constexpr (std::is_arithmetic_v<Key>) {
+            for (size_t r = 0; r < key_offsets.size(); ++r) {
+                if ((int)r == self) continue;
+                DeltaCodec<Key>::decode(incoming_.data() + byte_offsets[r], counts[2 * r], bucket + key_offsets[r]);
+            }
+        }
+    }
+
+    // Phase 2: settle the splitters between `buckets` buckets of the ranks of a transport, bucket
+    // j ending at the first rank of group j + 1, by histogramming rounds. The top level also
+    // records the splitter ranks for the accessors
+    std::vector<Sample<Key>> select_splitters(Transport& transport, const Key* keys, size_t n, int buckets,
+                                              double epsilon) {
+        const int p = transport.size();
+        const int rank = transport.rank();
+        const bool top = stats_.levels == 1;
+        uint64_t total = n;
+        transport.all_reduce_sum(&total, 1);
+        oversampling_ = options_.oversampling > 0 ? options_.oversampling : histogram_sample_ratio(epsilon);
+        const double tolerance = epsilon * total / (2.0 * buckets);
+        if (top) {
+            splitters_.clear();
+            splitter_ranks_.clear();
+            splitter_targets_.clear();
+            global_size_ = total;
+            splitter_tolerance_ = tolerance;
+        }
+        if (buckets < 2 || total == 0) return {};
+
+        std::vector<Interval> intervals(buckets - 1);
+        for (int i = 0; i < buckets - 1; ++i) {
+            const uint64_t target = group_begin(i + 1, p, buckets) * total / p;
+            intervals[i] = {target, 0, total, 0, n, false, false, {}, 0};
+        }
+        const int max_rounds = options_.max_splitter_rounds > 1 ? options_.max_splitter_rounds : HISTOGRAM_MAX_ROUNDS;
+        std::vector<Sample<Key>> local_samples, samples;
+        std::vector<uint64_t> histogram, local_histogram;
+        for (int round = 1; round <= max_rounds; ++round) {
+            // Phase 2a: splitters sharing an interval sample it together. Each rank takes its
+            // share of k samples per splitter, rounded up so that every non-empty interval
+            // yields at least one sample
+            auto start_phase2a = Clock::now();
+            std::mt19937_64 rng(options_.random_seed + transport_.rank() + (uint64_t)stats_.rounds * transport_.size());
+            local_samples.clear();
+            bool open = false;
+            for (size_t i = 0; i < intervals.size();) {
+                if (intervals[i].settled) {
+                    ++i;
+                    continue;
+                }
+                open = true;
+                const Interval& interval = intervals[i];
+                size_t shared = 0;
+                for (; i < intervals.size() && !intervals[i].settled && intervals[i].lo_rank == interval.lo_rank &&
+                       intervals[i].hi_rank == interval.hi_rank; ++i) {
+                    shared++;
+                }
+                const size_t local = interval.hi_local - interval.lo_local;
+                const uint64_t global = interval.hi_rank - interval.lo_rank;
+                const size_t wanted = static_cast<size_t>(
+                    std::ceil(static_cast<double>(oversampling_) * shared * local / std::max<uint64_t>(global, 1)));
+                if (wanted >= local) {
+                    for (size_t pos = interval.lo_local; pos < interval.hi_local; ++pos) {
+                        local_samples.push_back({keys[pos], rank, pos});
+                    }
+                } else {
+                    std::uniform_int_distribution<size_t> position(interval.lo_local, interval.hi_local - 1);
+                    for (size_t s = 0; s < wanted; ++s) {
+                        const size_t pos = position(rng);
+                        local_samples.push_back({keys[pos], rank, pos});
+                    }
+                }
+            }
+            if (!open) break;
+            stats_.rounds++;
+            transport.all_gather_v(local_samples, samples);
+            std::sort(samples.begin(), samples.end(), [this](const Sample<Key>& a, const Sample<Key>& b) {
+                return sample_less(a, b);
+            });
+            samples.erase(std::unique(samples.begin(), samples.end(),
+                                      [](const Sample<Key>& a, const Sample<Key>& b) {
+                                          return a.worker == b.worker && a.position == b.position;
+                                      }),
+                          samples.end());
+            stats_.samples += samples.size();
+            stats_.phase2a_duration += Duration(Clock::now() - start_phase2a).count();
+
+            // Phase 2b: global ranks of the samples, then settle or narrow every open interval
+            auto start_phase2b = Clock::now();
+            local_histogram.resize(samples.size());
+            for (size_t s = 0; s < samples.size(); ++s) {
+                local_histogram[s] = detail::splitter_bound(samples[s], keys, n, rank, less_);
+            }
+            histogram = local_histogram;
+            transport.all_reduce_sum(histogram.data(), histogram.size());
+            for (Interval& interval : intervals) {
+                if (interval.settled) continue;
+                // First sample past the target; global ranks grow with the sample order
+                const size_t above = std::upper_bound(histogram.begin(), histogram.end(), interval.target) -
+                                     histogram.begin();
+                auto consider = [&](size_t s) {
+                    const uint64_t distance = histogram[s] > interval.target ? histogram[s] - interval.target
+                                                                             : interval.target - histogram[s];
+                    const uint64_t best = interval.best_rank > interval.target ? interval.best_rank - interval.target
+                                                                               : interval.target - interval.best_rank;
+                    if (!interval.has_best || distance < best) {
+                        interval.best = samples[s];
+                        interval.best_rank = histogram[s];
+                        interval.has_best = true;
+                    }
+                };
+                if (above > 0) {
+                    consider(above - 1);
+                    if (histogram[above - 1] > interval.lo_rank) {
+                        interval.lo_rank = histogram[above - 1];
+                        interval.lo_local = local_histogram[above - 1];
+                    }
+                }
+                if (above < samples.size()) {
+                    consider(above);
+                    if (histogram[above] < interval.hi_rank) {
+                        interval.hi_rank = histogram[above];
+                        interval.hi_local = local_histogram[above];
+                    }
+                }
+                const uint64_t error = interval.best_rank > interval.target ? interval.best_rank - interval.target
+                                                                            : interval.target - interval.best_rank;
+                interval.settled = interval.has_best && error <= tolerance;
+            }
+            stats_.phase2b_duration += Duration(Clock::now() - start_phase2b).count();
+        }
+        std::vector<Sample<Key>> splitters;
+        for (const Interval& interval : intervals) {
+            splitters.push_back(interval.best);
+            if (top) {
+                splitter_ranks_.push_back(interval.best_rank);
+                splitter_targets_.push_back(interval.target);
+            }
+        }
+        if (top) splitters_ = splitters;
+        return splitters;
+    }
+
+    Transport& transport_;
+    Options options_;
+    Less less_;
+    DistributedStats stats_ = DistributedStats();
+    std::vector<Sample<Key>> splitters_;
+    std::vector<uint64_t> splitter_ranks_;
+    std::vector<uint64_t> splitter_targets_;
+    double splitter_tolerance_ = 0.0;
+    std::vector<unsigned char> encoded_;  // Outgoing pieces of a compressed exchange
+    std::vector<unsigned char> incoming_; // Incoming pieces of a compressed exchange
+    uint64_t global_size_ = 0;
+    size_t oversampling_ = 0;
+};
+
+// Streaming sorter: batches are sorted by a Sorter into runs while the caller ingests the
+// next batch, and a background merger keeps a leveled set of runs; flush() merges the rest
+template <typename Key, typename Less = KeyLess<Key>>
+class StreamSorter {
+public:
+    // A level is merged into one run on the next level once it holds fan_in runs
+    explicit StreamSorter(const Options& options = Options(), Less less = Less(), size_t fan_in = 4)
+        : sorter_(options, less), fan_in_(std::max<size_t>(fan_in, 2)) {
+        pthread_mutex_init(&lock_, nullptr);
+        pthread_cond_init(&changed_, nullptr);
+        pthread_create(&merger_, nullptr, merger_thread, this);
+    }
+
+    ~StreamSorter() {
+        wait_for_batch();
+        stop_merger();
+        pthread_cond_destroy(&changed_);
+        pthread_mutex_destroy(&lock_);
+    }
+
+    StreamSorter(const StreamSorter&) = delete;
+    StreamSorter& operator=(const StreamSorter&) = delete;
+
+    // Hand over a batch; it is sorted asynchronously and this returns immediately,
+    // after waiting for the previous batch if it is still being sorted
+    void add_batch(std::vector<Key>&& batch) {
+        wait_for_batch();
+        if (batch.empty()) return;
+        pending_ = std::move(batch);
+        batches_++;
+        keys_ingested_ += pending_.size();
+        pthread_create(&batch_thread_, nullptr, batch_thread, this);
+        batch_running_ = true;
+    }
+
+    // Wait for all pending work and return every key ingested so far in sorted order
+    std::vector<Key> flush() {
+        wait_for_batch();
+        stop_merger();
+
+        auto start_flush = Clock::now();
+        std::vector<std::vector<Key>> remaining_runs;
+        for (auto& level : levels_) {
+            for (auto& run : level) remaining_runs.push_back(std::move(run));
+        }
+        levels_.clear();
+        final_runs_ = remaining_runs.size();
+        std::vector<Key> sorted_output = merge_runs(std::move(remaining_runs));
+        flush_duration_ = Duration(Clock::now() - start_flush).count();
+        return sorted_output;
+    }
+
+    const Less& less() const { return sorter_.less(); }
+    size_t batches() const { return batches_; }
+    size_t keys_ingested() const { return keys_ingested_; }
+    size_t background_merges() const { return background_merges_; }
+    size_t final_runs() const { return final_runs_; }
+    double sort_duration() const { return sort_duration_; }      // HSS time over all batches
+    double merge_duration() const { return merge_duration_; }    // Background merge time
+    double flush_duration() const { return flush_duration_; }    // Final merge time
+
+private:
+    // Merge sorted runs pairwise until a single sorted run remains
+    std::vector<Key> merge_runs(std::vector<std::vector<Key>> runs) const {
+        if (runs.empty()) return {};
+        while (runs.size() > 1) {
+            std::vector<std::vector<Key>> merged((runs.size() + 1) / 2);
+            for (size_t i = 0; i + 1 < runs.size(); i += 2) {
+                merged[i / 2].resize(runs[i].size() + runs[i + 1].size());
+                std::merge(runs[i].begin(), runs[i].end(),
+                           runs[i + 1].begin(), runs[i + 1].end(), merged[i / 2].begin(), less());
+            }
+            if (runs.size() % 2 == 1) {
+                merged.back() = std::move(runs.back());
+            }
+            runs.swap(merged);
+        }
+        return std::move(runs.front());
+    }
+
+    // Lowest level holding a full set of runs, or -1 if nothing needs merging (lock held)
+    int find_full_level() const {
+        for (size_t level = 0; level < levels_.size(); ++level) {
+            if (levels_[level].size() >= fan_in_) return static_cast<int>(level);
+        }
+        return -1;
+    }
+
+    // Sort the pending batch with HSS and publish it as a level-0 run
+    static void* batch_thread(void* arg) {
+        StreamSorter* self = static_cast<StreamSorter*>(arg);
+        auto start_sort = Clock::now();
+        std::vector<Key> run = std::move(self->pending_);
+        self->sorter_.sort(run.data(), run.size());
+        self->sort_duration_ += Duration(Clock::now() - start_sort).count();
+
+        pthread_mutex_lock(&self->lock_);
+        if (self->levels_.empty()) self->levels_.resize(1);
+        self->levels_[0].push_back(std::move(run));
+        pthread_cond_signal(&self->changed_);
+        pthread_mutex_unlock(&self->lock_);
+        return nullptr;
+    }
+
+    // Background merger: compacts full levels into the next level while ingest continues
+    static void* merger_thread(void* arg) {
+        StreamSorter* self = static_cast<StreamSorter*>(arg);
+        pthread_mutex_lock(&self->lock_);
+        while (true) {
+            int level = self->find_full_level();
+            if (level < 0) {
+                if (self->flushing_) break;
+                pthread_cond_wait(&self->changed_, &self->lock_);
+                continue;
+            }
+            std::vector<std::vector<Key>> runs;
+            runs.swap(self->levels_[level]);
+            pthread_mutex_unlock(&self->lock_);
+
+            auto start_merge = Clock::now();
+            std::vector<Key> merged = self->merge_runs(std::move(runs));
+            double merge_time = Duration(Clock::now() - start_merge).count();
+
+            pthread_mutex_lock(&self->lock_);
+            if (self->levels_.size() <= (size_t)level + 1) {
+                self->levels_.resize(level + 2);
+            }
+            self->levels_[level + 1].push_back(std::move(merged));
+            self->background_merges_++;
+            self->merge_duration_ += merge_time;
+        }
+        pthread_mutex_unlock(&self->lock_);
+        return nullptr;
+    }
+
+    void wait_for_batch() {
+        if (batch_running_) {
+            pthread_join(batch_thread_, nullptr);
+            batch_running_ = false;
+        }
+    }
+
+    // Let the merger drain full levels and exit
+    void stop_merger() {
+        if (!merger_running_) return;
+        pthread_mutex_lock(&lock_);
+        flushing_ = true;
+        pthread_cond_signal(&changed_);
+        pthread_mutex_unlock(&lock_);
+        pthread_join(merger_, nullptr);
+        merger_running_ = false;
+    }
+
+    Sorter<Key, Less> sorter_;          // Reused for every batch
+    const size_t fan_in_;
+    std::vector<Key> pending_;          // Batch handed to the batch thread
+
+    std::vector<std::vector<std::vector<Key>>> levels_; // [level][run][elements]
+    pthread_mutex_t lock_;              // Protects levels_ and flushing_
+    pthread_cond_t changed_;            // Signalled when a run is added or flush starts
+    bool flushing_ = false;             // Ingest finished, merger should drain and exit
+    pthread_t merger_;
+    bool merger_running_ = true;
+    pthread_t batch_thread_;
+    bool batch_running_ = false;
+
+    size_t batches_ = 0;
+    size_t keys_ingested_ = 0;
+    size_t background_merges_ = 0;
+    size_t final_runs_ = 0;
+    double sort_duration_ = 0.0;
+    double merge_duration_ = 0.0;
+    double flush_duration_ = 0.0;
+};
+
+namespace detail {
+
+// Sort [first, last) with a temporary sorter; contiguous ranges are sorted in place
+template <typename Less, typename RandomIt>
+void sort_range(RandomIt first, RandomIt last, Less less, const Options& options) {
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    const size_t n = std::distance(first, last);
+    if (n < 2) return;
+    Sorter<T, Less> sorter(options, std::move(less));
+    if constexpr (std::is_pointer_v<RandomIt> ||
+                  (std::is_same_v<RandomIt, typename std::vector<T>::iterator> && !std::is_same_v<T, bool>)) {
+        sorter.sort(&*first, n);
+    } else {
+        std::vector<T> buffer(first, last);
+        sorter.sort(buffer.data(), n);
+        std::move(buffer.begin(), buffer.end(), first);
+    }
+}
+
+} // namespace detail
+
+// Sort [first, last) in parallel with HSS, ordering elements by comp(proj(a), proj(b)) as the
+// C++20 ranges algorithms do. comp and proj are template parameters, so every comparison is
+// inlined. Each call uses its own Sorter, so concurrent calls are independent.
+template <typename RandomIt, typename Comp = std::less<>, typename Proj = Identity>
+void sort(RandomIt first, RandomIt last, Comp comp = {}, Proj proj = {}, const Options& options = {}) {
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    if constexpr (std::is_integral_v<T> && std::is_same_v<Comp, std::less<>> &&
+                  std::is_same_v<Proj, Identity>) {
+        // Plain ascending integer sorts keep the radix backend
+        detail::sort_range(first, last, KeyLess<T>(), options);
+    } else {
+        detail::sort_range(first, last, ProjectedLess<Comp, Proj>{std::move(comp), std::move(proj)}, options);
+    }
+}
+
+} // namespace hss
+
+#endif // HSS_HPP